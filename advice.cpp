@@ -1,12 +1,6 @@
 #include "advice.h"
-#include <algorithm>
-#include <iostream>
-#include <vector>
-#include <deque>
-#include <curl_easy.h>
-#include <curl_header.h>
-#include <sstream>
-#include <list>
+#include "trace.h"
+#include "logger.h"
 #include <chrono>
 #include <thread>
 #include <yaml-cpp/yaml.h>
@@ -19,6 +13,26 @@ advice::advice(
   // Load the config file.
   YAML::Node config = YAML::LoadFile(configFile);
 
+  // Set how much to log.
+  if (config["log_level"])
+  {
+    globalLog().setLevel(parseLogLevel(config["log_level"].as<std::string>()));
+  }
+
+  // Start exporting metrics.
+  if (config["metrics_file"])
+  {
+    std::chrono::seconds metricsInterval(15);
+    if (config["metrics_interval_seconds"])
+    {
+      metricsInterval = std::chrono::seconds(config["metrics_interval_seconds"].as<int>());
+    }
+
+    metrics_ = std::unique_ptr<metrics_exporter>(new metrics_exporter(
+      config["metrics_file"].as<std::string>(),
+      metricsInterval));
+  }
+
   // Set up the Twitter client.
   twitter::auth auth;
   auth.setConsumerKey(config["consumer_key"].as<std::string>());
@@ -31,305 +45,206 @@ advice::advice(
   // Set up the verbly database.
   database_ = std::unique_ptr<verbly::database>(new verbly::database(config["verbly_datafile"].as<std::string>()));
 
+  // Load the nouns that can be pictured.
+  std::string picturesCache;
+  if (config["picture_nouns_cache"])
+  {
+    picturesCache = config["picture_nouns_cache"].as<std::string>();
+  }
+
+  pictures_ = loadPictureNouns(
+    *database_,
+    config["verbly_datafile"].as<std::string>(),
+    picture_lists::read(config),
+    picturesCache);
+
   // Set up the sentence generator.
   generator_ = std::unique_ptr<sentence>(new sentence(*database_, rng_));
 
-  // Read font file path.
-  fontfile_ = "@" + config["font"].as<std::string>();
-}
+  // Set up the renderer.
+  renderer_ = std::unique_ptr<renderer>(new renderer("@" + config["font"].as<std::string>()));
 
-void advice::run() const
-{
-  for (;;)
+  // Set up the encoder.
+  encoder_ = std::unique_ptr<encoder>(new encoder(encoder_config::read(config)));
+
+  // Set up the posting schedule.
+  scheduler_config schedulerConfig;
+  if (config["post_interval_minutes"])
   {
-    try
-    {
-      verbly::filter whitelist =
-        (verbly::notion::wnid == 109287968)    // Geological formations
-        || (verbly::notion::wnid == 109208496) // Asterisms (collections of stars)
-        || (verbly::notion::wnid == 109239740) // Celestial bodies
-        || (verbly::notion::wnid == 109277686) // Exterrestrial objects (comets and meteroids)
-        || (verbly::notion::wnid == 109403211) // Radiators (supposedly natural radiators but actually these are just pictures of radiators)
-        || (verbly::notion::wnid == 109416076) // Rocks
-        || (verbly::notion::wnid == 105442131) // Chromosomes
-        || (verbly::notion::wnid == 100324978) // Tightrope walking
-        || (verbly::notion::wnid == 100326094) // Rock climbing
-        || (verbly::notion::wnid == 100433458) // Contact sports
-        || (verbly::notion::wnid == 100433802) // Gymnastics
-        || (verbly::notion::wnid == 100439826) // Track and field
-        || (verbly::notion::wnid == 100440747) // Skiing
-        || (verbly::notion::wnid == 100441824) // Water sport
-        || (verbly::notion::wnid == 100445351) // Rowing
-        || (verbly::notion::wnid == 100446980) // Archery
-          // TODO: add more sports
-        || (verbly::notion::wnid == 100021939) // Artifacts
-        || (verbly::notion::wnid == 101471682) // Vertebrates
-          ;
-
-      verbly::filter blacklist =
-        (verbly::notion::wnid == 106883725) // swastika
-        || (verbly::notion::wnid == 104416901) // tetraskele
-        || (verbly::notion::wnid == 102512053) // fish
-        || (verbly::notion::wnid == 103575691) // instrument of execution
-        || (verbly::notion::wnid == 103829563) // noose
-          ;
-
-      verbly::query<verbly::word> pictureQuery = database_->words(
-        (verbly::notion::fullHypernyms %= whitelist)
-        && !(verbly::notion::fullHypernyms %= blacklist)
-        && (verbly::notion::partOfSpeech == verbly::part_of_speech::noun)
-        && (verbly::notion::numOfImages >= 1));
-
-      verbly::word pictured = pictureQuery.first();
-
-      // Accept string from Google Chrome
-      std::string accept = "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8";
-      curl::curl_header headers;
-      headers.add(accept);
-
-      int backoff = 0;
-
-      std::cout << "Generating noun..." << std::endl;
-      std::cout << "Noun: " << pictured.getBaseForm().getText() << std::endl;
-      std::cout << "Getting URLs..." << std::endl;
-
-      std::string lstdata;
-      while (lstdata.empty())
-      {
-        std::ostringstream lstbuf;
-        curl::curl_ios<std::ostringstream> lstios(lstbuf);
-        curl::curl_easy lsthandle(lstios);
-        std::string lsturl = pictured.getNotion().getImageNetUrl();
-        lsthandle.add<CURLOPT_URL>(lsturl.c_str());
-        lsthandle.add<CURLOPT_CONNECTTIMEOUT>(30);
-        lsthandle.add<CURLOPT_TIMEOUT>(300);
-
-        try
-        {
-          lsthandle.perform();
-        } catch (const curl::curl_easy_exception& e)
-        {
-          e.print_traceback();
-
-          backoff++;
-          std::cout << "Waiting for " << backoff << " seconds..." << std::endl;
-
-          std::this_thread::sleep_for(std::chrono::seconds(backoff));
-
-          continue;
-        }
-
-        backoff = 0;
-
-        if (lsthandle.get_info<CURLINFO_RESPONSE_CODE>().get() != 200)
-        {
-          throw could_not_get_images();
-        }
-
-        std::cout << "Got URLs." << std::endl;
-        lstdata = lstbuf.str();
-      }
+    schedulerConfig.interval = std::chrono::minutes(config["post_interval_minutes"].as<int>());
+  }
 
-      std::vector<std::string> lstvec = verbly::split<std::vector<std::string>>(lstdata, "\r\n");
-      if (lstvec.empty())
-      {
-        throw could_not_get_images();
-      }
+  if (config["retry_base_seconds"])
+  {
+    schedulerConfig.baseBackoff = std::chrono::seconds(config["retry_base_seconds"].as<int>());
+  }
 
-      std::shuffle(std::begin(lstvec), std::end(lstvec), rng_);
+  if (config["retry_max_minutes"])
+  {
+    schedulerConfig.maxBackoff = std::chrono::minutes(config["retry_max_minutes"].as<int>());
+  }
 
-      std::deque<std::string> urls;
-      for (std::string& url : lstvec)
-      {
-        urls.push_back(url);
-      }
+  scheduler_ = std::unique_ptr<scheduler>(new scheduler(schedulerConfig, rng_()));
 
-      bool found = false;
-      Magick::Blob img;
-      Magick::Image pic;
+  // Publish posts in the background.
+  std::string outboxDir;
+  if (config["outbox_dir"])
+  {
+    outboxDir = config["outbox_dir"].as<std::string>();
+  }
 
-      while (!found && !urls.empty())
-      {
-        std::string url = urls.front();
-        urls.pop_front();
-
-        std::ostringstream imgbuf;
-        curl::curl_ios<std::ostringstream> imgios(imgbuf);
-        curl::curl_easy imghandle(imgios);
-
-        imghandle.add<CURLOPT_HTTPHEADER>(headers.get());
-        imghandle.add<CURLOPT_URL>(url.c_str());
-        imghandle.add<CURLOPT_CONNECTTIMEOUT>(30);
-        imghandle.add<CURLOPT_TIMEOUT>(300);
-
-        try
-        {
-          imghandle.perform();
-        } catch (const curl::curl_easy_exception& error) {
-          error.print_traceback();
-
-          continue;
-        }
-
-        if (imghandle.get_info<CURLINFO_RESPONSE_CODE>().get() != 200)
-        {
-          continue;
-        }
-
-        std::string content_type = imghandle.get_info<CURLINFO_CONTENT_TYPE>().get();
-        if (content_type.substr(0, 6) != "image/")
-        {
-          continue;
-        }
-
-        std::string imgstr = imgbuf.str();
-        img = Magick::Blob(imgstr.c_str(), imgstr.length());
-
-        try
-        {
-          pic.read(img);
-
-          if ((pic.rows() > 0) && (pic.columns() >= 400))
-          {
-            std::cout << url << std::endl;
-            found = true;
-          }
-        } catch (const Magick::ErrorOption& e)
-        {
-          // Occurs when the the data downloaded from the server is malformed
-          std::cout << "Magick: " << e.what() << std::endl;
-        }
-      }
+  size_t outboxDepth = 2;
+  if (config["outbox_depth"])
+  {
+    outboxDepth = config["outbox_depth"].as<size_t>();
+  }
 
-      if (!found)
-      {
-        throw could_not_get_images();
-      }
+  int postAttempts = 5;
+  if (config["post_attempts"])
+  {
+    postAttempts = config["post_attempts"].as<int>();
+  }
 
-      std::string title = generator_->generate();
+  poster_ = std::unique_ptr<poster>(new poster(
+    *client_,
+    *scheduler_,
+    outboxDir,
+    outboxDepth,
+    postAttempts));
 
-      // Want a 16:9 aspect
-      int idealwidth = pic.rows()*(16.0/9.0);
-      if (idealwidth > pic.columns())
-      {
-        // If the image is narrower than the ideal width, use full width.
-        int newheight = pic.columns()*(9.0/16.0);
+  // Start looking for pictures in the background.
+  finder_config finderConfig;
+  if (config["concurrent_fetches"])
+  {
+    finderConfig.concurrency = config["concurrent_fetches"].as<size_t>();
+  }
 
-        // Just take a slice out of the middle of the image.
-        int cropy = ((double)(pic.rows() - newheight))/2.0;
+  if (config["image_cache_dir"])
+  {
+    finderConfig.cacheDirectory = config["image_cache_dir"].as<std::string>();
+  }
 
-        pic.crop(Magick::Geometry(pic.columns(), newheight, 0, cropy));
-      } else {
-        // If the image is wider than the ideal width, use full height.
-        // Just take a slice out of the middle of the image.
-        int cropx = ((double)(pic.columns() - idealwidth))/2.0;
+  if (config["image_cache_mb"])
+  {
+    finderConfig.cacheBytes = config["image_cache_mb"].as<uint64_t>() * 1024 * 1024;
+  }
 
-        pic.crop(Magick::Geometry(idealwidth, pic.rows(), cropx, 0));
-      }
+  if (config["url_list_cache_dir"])
+  {
+    finderConfig.urlListDirectory = config["url_list_cache_dir"].as<std::string>();
+  }
+
+  if (config["url_list_ttl_hours"])
+  {
+    finderConfig.urlListTtl = std::chrono::hours(config["url_list_ttl_hours"].as<int>());
+  }
+
+  if (config["dead_url_file"])
+  {
+    finderConfig.deadUrlFile = config["dead_url_file"].as<std::string>();
+  }
+
+  if (config["dead_url_ttl_days"])
+  {
+    finderConfig.deadUrlTtl = std::chrono::hours(24 * config["dead_url_ttl_days"].as<int>());
+  }
+
+  size_t prefetchDepth = 3;
+  if (config["prefetch_depth"])
+  {
+    prefetchDepth = config["prefetch_depth"].as<size_t>();
+  }
+
+  size_t prefetchMemory = 64;
+  if (config["prefetch_memory_mb"])
+  {
+    prefetchMemory = config["prefetch_memory_mb"].as<size_t>();
+  }
 
-      pic.zoom(Magick::Geometry(400, 225));
+  prefetcher_ = std::unique_ptr<prefetcher>(new prefetcher(
+    config["verbly_datafile"].as<std::string>(),
+    *pictures_,
+    *renderer_,
+    *scheduler_,
+    finderConfig,
+    prefetchDepth,
+    prefetchMemory * 1024 * 1024,
+    rng_()));
+}
 
-      // Layout the text.
-      std::list<std::string> words = verbly::split<std::list<std::string>>(title, " ");
-      std::vector<std::string> lines;
-      std::list<std::string> cur;
-      Magick::TypeMetric metric;
-      pic.fontPointsize(20);
-      pic.font(fontfile_);
+void advice::run() const
+{
+  for (unsigned long iteration = 1;; iteration++)
+  {
+    trace_span span("iteration", "advice");
 
-      while (!words.empty())
+    if (span.active())
+    {
+      span.annotate("iteration", std::to_string(iteration));
+    }
+
+    try
+    {
+      picture next;
       {
-        cur.push_back(words.front());
-
-        std::string prefixText = verbly::implode(std::begin(cur), std::end(cur), " ");
-        pic.fontTypeMetrics(prefixText, &metric);
-
-        if (metric.textWidth() > 380)
-        {
-          if (cur.size() == 1)
-          {
-            words.pop_front();
-          } else {
-            cur.pop_back();
-          }
-
-          prefixText = verbly::implode(std::begin(cur), std::end(cur), " ");
-          lines.push_back(prefixText);
-          cur.clear();
-        } else {
-          words.pop_front();
-        }
+        trace_span popSpan("wait_for_picture", "advice");
+        next = prefetcher_->pop();
       }
 
-      if (!cur.empty())
+      Magick::Image pic = next.image;
+
+      std::string title;
       {
-        std::string prefixText = verbly::implode(std::begin(cur), std::end(cur), " ");
-        lines.push_back(prefixText);
+        stage_timer timer(stage::generate);
+        trace_span stageSpan("generate", "advice");
+        title = generator_->generate();
       }
+      LOG(info) << "Query memo: " << generator_->getQueryStats();
 
-      int lineHeight = metric.textHeight()-2;
-      int blockHeight = lineHeight * lines.size() + 18;
-      std::cout << "line " << lineHeight << "; block " << blockHeight << std::endl;
-
-      std::list<Magick::Drawable> drawList;
-      drawList.push_back(Magick::DrawableFillColor("black"));
-      drawList.push_back(Magick::DrawableFillOpacity(0.5));
-      drawList.push_back(Magick::DrawableStrokeColor("transparent"));
-      drawList.push_back(Magick::DrawableRectangle(0, 225-blockHeight-20, 400, 255)); // 0, 225-60, 400, 255
-      pic.draw(drawList);
-
-      drawList.clear();
-      drawList.push_back(Magick::DrawableFont(fontfile_));
-      drawList.push_back(Magick::DrawableFillColor("white"));
-      drawList.push_back(Magick::DrawablePointSize(14));
-      drawList.push_back(Magick::DrawableText(10, 225-blockHeight+4, "How to")); // 10, 255-62-4
-      pic.draw(drawList);
-
-      for (int i=0; i<lines.size(); i++)
+      text_layout layout;
       {
-        drawList.clear();
-        drawList.push_back(Magick::DrawableFont(fontfile_));
-        drawList.push_back(Magick::DrawableFillColor("white"));
-        drawList.push_back(Magick::DrawablePointSize(20));
-        drawList.push_back(Magick::DrawableText(10, 255-blockHeight+(i*lineHeight)-4, lines[i])); // 10, 255-20-25
-        pic.draw(drawList);
+        stage_timer timer(stage::layout);
+        trace_span stageSpan("layout", "advice");
+        layout = renderer_->layoutText(title);
       }
+      LOG(debug) << "line " << layout.lineHeight << "; block " << layout.blockHeight();
 
-      Magick::Blob outputimg;
-
-      try
-      {
-        pic.magick("png");
-        pic.write(&outputimg);
-      } catch (const Magick::WarningCoder& e)
       {
-        // Ignore
+        stage_timer timer(stage::draw);
+        trace_span stageSpan("draw", "advice");
+        renderer_->drawOverlay(pic, layout);
       }
 
-      std::cout << "Generated image!" << std::endl << "Tweeting..." << std::endl;
-
-      std::string tweetText = "How to " + title;
-      size_t tweetLim = 140 - client_->getConfiguration().getCharactersReservedPerMedia();
-      if (tweetText.length() > tweetLim)
+      encoded_image outputimg;
       {
-        tweetText = tweetText.substr(0, tweetLim - 1) + "…";
+        stage_timer timer(stage::encode);
+        trace_span stageSpan("encode", "advice");
+        outputimg = encoder_->encode(pic);
       }
 
-      long media_id = client_->uploadMedia("image/png", (const char*) outputimg.data(), outputimg.length());
-      client_->updateStatus(tweetText, {media_id});
+      LOG(info) << "Generated image!";
+      LOG(info) << "Encoded " << outputimg.data.length() << " bytes as "
+        << outputimg.mimeType << " (setting " << outputimg.setting << ") in "
+        << static_cast<int>(outputimg.elapsed.count() * 1000) << "ms";
 
-      std::cout << "Tweeted!" << std::endl << "Waiting..." << std::endl;
+      if (span.active())
+      {
+        span.annotate("noun", next.noun);
+        span.annotate("url", next.url);
+        span.annotate("title", title);
+      }
 
-      std::this_thread::sleep_for(std::chrono::hours(1));
-    } catch (const could_not_get_images& ex)
-    {
-      std::cout << ex.what() << std::endl;
+      // This waits while the outbox is full, and the next post is rendered
+      // as soon as there is room, even while one is uploading.
+      trace_span submitSpan("submit", "advice");
+      poster_->submit(title, outputimg);
     } catch (const Magick::ErrorImage& ex)
     {
-      std::cout << "Image error: " << ex.what() << std::endl;
-    } catch (const twitter::twitter_error& ex)
-    {
-      std::cout << "Twitter error: " << ex.what() << std::endl;
+      LOG(warning) << "Image error: " << ex.what();
+
+      globalMetrics().countFailure(failure_kind::image_error);
+
+      std::this_thread::sleep_for(scheduler_->failed(failure_class::image));
     }
   }
 }
@@ -7,8 +7,15 @@
 #include <string>
 #include <memory>
 #include <Magick++.h>
-#include <stdexcept>
 #include "sentence.h"
+#include "word_pool.h"
+#include "picture_nouns.h"
+#include "renderer.h"
+#include "encoder.h"
+#include "prefetcher.h"
+#include "scheduler.h"
+#include "poster.h"
+#include "metrics.h"
 
 class advice {
 public:
@@ -21,19 +28,17 @@ public:
 
 private:
 
-  class could_not_get_images : public std::runtime_error {
-  public:
-
-    could_not_get_images() : std::runtime_error("Could not get images for noun")
-    {
-    }
-  };
-
   std::mt19937& rng_;
+  std::unique_ptr<metrics_exporter> metrics_;
   std::unique_ptr<verbly::database> database_;
+  std::unique_ptr<word_pool> pictures_;
   std::unique_ptr<sentence> generator_;
   std::unique_ptr<twitter::client> client_;
-  std::string fontfile_;
+  std::unique_ptr<renderer> renderer_;
+  std::unique_ptr<encoder> encoder_;
+  std::unique_ptr<scheduler> scheduler_;
+  std::unique_ptr<poster> poster_;
+  std::unique_ptr<prefetcher> prefetcher_;
 };
 
 #endif /* end of include guard: ADVICE_H_5934AC1B */
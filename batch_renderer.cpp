@@ -0,0 +1,185 @@
+#include "batch_renderer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <yaml-cpp/yaml.h>
+#include "sentence.h"
+#include "logger.h"
+
+namespace {
+
+  std::vector<std::string> listImages(const std::string& directory)
+  {
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr)
+    {
+      throw std::invalid_argument("Could not open directory " + directory);
+    }
+
+    std::vector<std::string> result;
+    while (dirent* entry = readdir(dir))
+    {
+      std::string name(entry->d_name);
+      if (name.empty() || (name[0] == '.'))
+      {
+        continue;
+      }
+
+      result.push_back(std::move(name));
+    }
+
+    closedir(dir);
+
+    std::sort(std::begin(result), std::end(result));
+
+    return result;
+  }
+
+  std::string outputName(const std::string& name, const std::string& mimeType)
+  {
+    std::string extension = mimeType.substr(mimeType.find('/') + 1);
+
+    // Inputs that differ only by extension must not share an output.
+    return name + "." + extension;
+  }
+
+}
+
+batch_renderer::batch_renderer(
+  std::string configFile,
+  std::mt19937& rng) :
+    rng_(rng)
+{
+  // Load the config file.
+  YAML::Node config = YAML::LoadFile(configFile);
+
+  // Set how much to log.
+  if (config["log_level"])
+  {
+    globalLog().setLevel(parseLogLevel(config["log_level"].as<std::string>()));
+  }
+
+  // Load the vocabulary that the workers will share.
+  datafile_ = config["verbly_datafile"].as<std::string>();
+  database_ = std::unique_ptr<verbly::database>(new verbly::database(datafile_));
+  vocabulary_ = std::make_shared<vocabulary>(*database_);
+
+  // Set up the renderer and encoder.
+  renderer_ = std::unique_ptr<renderer>(new renderer("@" + config["font"].as<std::string>()));
+  encoder_ = std::unique_ptr<encoder>(new encoder(encoder_config::read(config)));
+}
+
+void batch_renderer::run(
+  const std::string& inputDir,
+  const std::string& outputDir,
+  int threads) const
+{
+  std::vector<std::string> images = listImages(inputDir);
+  int count = images.size();
+
+  if (threads <= 0)
+  {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  threads = std::max(1, std::min(threads, count));
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  std::atomic<int> next(0);
+  std::atomic<int> rendered(0);
+  std::mutex resultsMutex;
+  std::exception_ptr failure;
+  query_stats stats;
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++)
+  {
+    std::mt19937::result_type seed = rng_();
+
+    workers.emplace_back([&, seed] () {
+      try
+      {
+        verbly::database database(datafile_);
+        std::mt19937 rng(seed);
+        sentence generator(database, rng, vocabulary_);
+
+        int current;
+        while ((current = next.fetch_add(1)) < count)
+        {
+          const std::string& name = images[current];
+
+          try
+          {
+            Magick::Image pic;
+            pic.size(Magick::Geometry(renderer::width, renderer::height));
+            pic.read(inputDir + "/" + name);
+
+            renderer_->cropAndZoom(pic);
+
+            std::string title = generator.generate();
+            text_layout layout = renderer_->layoutText(title);
+            renderer_->drawOverlay(pic, layout);
+
+            encoded_image outputimg = encoder_->encode(pic);
+
+            std::string outputPath = outputDir + "/" + outputName(name, outputimg.mimeType);
+            std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+            output.write(
+              static_cast<const char*>(outputimg.data.data()),
+              outputimg.data.length());
+
+            if (!output)
+            {
+              throw std::runtime_error("Could not write " + outputPath);
+            }
+
+            rendered++;
+
+            LOG(info) << name << ": How to " << title;
+          } catch (const Magick::Exception& ex)
+          {
+            LOG(warning) << name << ": Image error: " << ex.what();
+          }
+        }
+
+        std::lock_guard<std::mutex> resultsLock(resultsMutex);
+        stats += generator.getQueryStats();
+      } catch (...)
+      {
+        // Stop the other workers and report the first failure.
+        next = count;
+
+        std::lock_guard<std::mutex> resultsLock(resultsMutex);
+        if (!failure)
+        {
+          failure = std::current_exception();
+        }
+      }
+    });
+  }
+
+  for (std::thread& worker : workers)
+  {
+    worker.join();
+  }
+
+  if (failure)
+  {
+    std::rethrow_exception(failure);
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  LOG(info) << "Rendered " << rendered << " of " << count << " images in "
+    << elapsed.count() << "s on " << threads << " threads ("
+    << (rendered / std::max(elapsed.count(), 1e-9)) << " images/s)";
+  LOG(info) << "Query memo: " << stats;
+}
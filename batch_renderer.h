@@ -0,0 +1,47 @@
+#ifndef BATCH_RENDERER_H_D83A61F4
+#define BATCH_RENDERER_H_D83A61F4
+
+#include <verbly.h>
+#include <random>
+#include <string>
+#include <memory>
+#include "vocabulary.h"
+#include "renderer.h"
+#include "encoder.h"
+
+/**
+ * Renders every image in a local directory with a generated title, without
+ * fetching or posting anything, on several threads. Each worker has its own
+ * database connection, random engine and sentence generator, and they share
+ * the vocabulary, renderer and encoder.
+ */
+class batch_renderer {
+public:
+
+  batch_renderer(
+    std::string configFile,
+    std::mt19937& rng);
+
+  /**
+   * Renders the images in inputDir into outputDir, keeping their full names
+   * and appending the extension of the output format, so that a.jpg becomes
+   * a.jpg.png and never collides with a.png. Prints each title. Images
+   * that cannot be read are reported and skipped. If threads is not
+   * positive, one thread is used per core.
+   */
+  void run(
+    const std::string& inputDir,
+    const std::string& outputDir,
+    int threads) const;
+
+private:
+
+  std::mt19937& rng_;
+  std::string datafile_;
+  std::unique_ptr<verbly::database> database_;
+  std::shared_ptr<const vocabulary> vocabulary_;
+  std::unique_ptr<renderer> renderer_;
+  std::unique_ptr<encoder> encoder_;
+};
+
+#endif /* end of include guard: BATCH_RENDERER_H_D83A61F4 */
@@ -0,0 +1,267 @@
+#include "harness.h"
+#include "renderer.h"
+#include "encoder.h"
+#include "sentence.h"
+#include "word_pool.h"
+#include "picture_nouns.h"
+#include "test/reference_layout.h"
+#include <verbly.h>
+#include <Magick++.h>
+#include <yaml-cpp/yaml.h>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+  Magick::Blob loadFixture(const std::string& path)
+  {
+    if (path.empty())
+    {
+      // Synthesize a large JPEG so that the benchmark does not depend on a
+      // file being present.
+      Magick::Image synth;
+      synth.read(Magick::Geometry(1600, 1200), "gradient:skyblue-darkgreen");
+      synth.magick("jpeg");
+
+      Magick::Blob result;
+      synth.write(&result);
+
+      return result;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+      throw std::invalid_argument("Could not open fixture " + path);
+    }
+
+    std::string data(
+      (std::istreambuf_iterator<char>(file)),
+      std::istreambuf_iterator<char>());
+
+    return Magick::Blob(data.data(), data.length());
+  }
+
+  // Forces a copy of the pixels so that modifying it is not charged with the
+  // copy-on-write.
+  Magick::Image freshCopy(const Magick::Image& image)
+  {
+    Magick::Image result = image;
+    result.modifyImage();
+
+    return result;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  Magick::InitializeMagick(nullptr);
+
+  std::string usage = "usage: advice_bench [configfile] [--iterations N] [--seed S] [--fixture FILE] [--json FILE]";
+
+  if (argc < 2)
+  {
+    std::cout << usage << std::endl;
+    return -1;
+  }
+
+  std::string configfile(argv[1]);
+  int iterations = 100;
+  unsigned int seed = 0;
+  std::string fixturefile;
+  std::string jsonfile;
+
+  try
+  {
+    for (int i = 2; i < argc; i++)
+    {
+      std::string arg(argv[i]);
+
+      if ((arg == "--iterations") && (i + 1 < argc))
+      {
+        iterations = std::stoi(argv[++i]);
+      } else if ((arg == "--seed") && (i + 1 < argc))
+      {
+        seed = std::stoul(argv[++i]);
+      } else if ((arg == "--fixture") && (i + 1 < argc))
+      {
+        fixturefile = argv[++i];
+      } else if ((arg == "--json") && (i + 1 < argc))
+      {
+        jsonfile = argv[++i];
+      } else {
+        throw std::invalid_argument(arg);
+      }
+    }
+  } catch (const std::logic_error& ex)
+  {
+    std::cout << usage << std::endl;
+    return -1;
+  }
+
+  if (iterations < 1)
+  {
+    std::cout << usage << std::endl;
+    return -1;
+  }
+
+  YAML::Node config = YAML::LoadFile(configfile);
+  verbly::database database(config["verbly_datafile"].as<std::string>());
+  std::string fontfile = "@" + config["font"].as<std::string>();
+  renderer render(fontfile);
+
+  std::mt19937 rng(seed);
+  sentence generator(database, rng);
+  word_pool pictures(database, picture_lists::read(config).condition());
+
+  std::vector<stage_result> results;
+  std::vector<std::string> titles;
+
+  results.push_back(sample("generate", iterations, [&] () {
+    titles.push_back(generator.generate());
+  }));
+
+  results.push_back(sample("picture_noun", iterations, [&] () {
+    verbly::word pictured = database.words(
+      verbly::word::id == pictures.choose(rng)).first();
+    keep(pictured);
+  }));
+
+  Magick::Blob fixture = loadFixture(fixturefile);
+  Magick::Image decoded;
+
+  results.push_back(sample("decode", iterations, [&] () {
+    decoded.read(fixture);
+  }));
+
+  Magick::Image cropped;
+
+  results.push_back(sample("crop_zoom", iterations,
+    [&] () {
+      return freshCopy(decoded);
+    },
+    [&] (Magick::Image& pic) {
+      render.cropAndZoom(pic);
+      cropped = pic;
+    }));
+
+  // Decoding straight to the output size should be much cheaper, and should
+  // look nearly the same once cropped.
+  Magick::Image decodedScaled;
+
+  results.push_back(sample("decode_scaled", iterations, [&] () {
+    decodedScaled.size(Magick::Geometry(renderer::width, renderer::height));
+    decodedScaled.read(fixture);
+  }));
+
+  Magick::Image croppedScaled;
+
+  results.push_back(sample("crop_zoom_scaled", iterations,
+    [&] () {
+      return freshCopy(decodedScaled);
+    },
+    [&] (Magick::Image& pic) {
+      render.cropAndZoom(pic);
+      croppedScaled = pic;
+    }));
+
+  Magick::Image difference = freshCopy(cropped);
+  difference.compare(croppedScaled);
+
+  std::vector<text_layout> layouts;
+  size_t title = 0;
+
+  results.push_back(sample("layout", iterations, [&] () {
+    layouts.push_back(render.layoutText(titles[title++ % titles.size()]));
+  }));
+
+  // The layout must break lines exactly where measuring every prefix would.
+  Magick::Image measuringImage(Magick::Geometry(1, 1), Magick::Color("white"));
+  measuringImage.font(fontfile);
+  measuringImage.fontPointsize(20);
+
+  int layoutMismatches = 0;
+  for (const std::string& checked : titles)
+  {
+    if (render.layoutText(checked).lines != referenceLayout(measuringImage, checked))
+    {
+      std::cout << "layout differs from reference: " << checked << std::endl;
+      layoutMismatches++;
+    }
+  }
+
+  Magick::Image overlaid;
+  size_t layout = 0;
+
+  results.push_back(sample("overlay", iterations,
+    [&] () {
+      return freshCopy(cropped);
+    },
+    [&] (Magick::Image& pic) {
+      render.drawOverlay(pic, layouts[layout++ % layouts.size()]);
+      overlaid = pic;
+    }));
+
+  // Each format is encoded with its default settings, and the sizes are
+  // reported alongside the timings.
+  std::vector<std::pair<std::string, output_format>> formats = {
+    {"encode_png", output_format::png},
+    {"encode_jpeg", output_format::jpeg}
+  };
+
+  std::vector<std::pair<std::string, size_t>> encodedSizes;
+
+  for (const auto& format : formats)
+  {
+    encoder_config encoderConfig;
+    encoderConfig.format = format.second;
+    encoder encode(encoderConfig);
+    size_t encodedSize = 0;
+
+    results.push_back(sample(format.first, iterations,
+      [&] () {
+        return freshCopy(overlaid);
+      },
+      [&] (Magick::Image& pic) {
+        encoded_image encoded = encode.encode(pic);
+        encodedSize = encoded.data.length();
+        keep(encoded);
+      }));
+
+    encodedSizes.emplace_back(format.first, encodedSize);
+  }
+
+  printResults(results, std::cout);
+
+  std::cout << "scaled decode: " << decoded.columns() << "x" << decoded.rows()
+    << " -> " << decodedScaled.columns() << "x" << decodedScaled.rows()
+    << ", normalized mean error " << difference.normalizedMeanError()
+    << ", normalized max error " << difference.normalizedMaxError()
+    << std::endl;
+
+  std::cout << "query memo: " << generator.getQueryStats() << std::endl;
+
+  for (const auto& encodedSize : encodedSizes)
+  {
+    std::cout << encodedSize.first << ": " << encodedSize.second << " bytes" << std::endl;
+  }
+
+  if (!jsonfile.empty())
+  {
+    std::ofstream json(jsonfile);
+    writeJson(results, json);
+  }
+
+  if (layoutMismatches > 0)
+  {
+    std::cout << layoutMismatches << " of " << titles.size()
+      << " titles were laid out differently from the reference" << std::endl;
+    return 1;
+  }
+}
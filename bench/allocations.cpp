@@ -0,0 +1,33 @@
+#include "harness.h"
+#include <cstdlib>
+#include <new>
+
+std::atomic<unsigned long> allocationCount(0);
+
+void* operator new(size_t size)
+{
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+  void* result = std::malloc(size == 0 ? 1 : size);
+  if (result == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+
+  return result;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  operator delete(ptr);
+}
@@ -0,0 +1,183 @@
+#ifndef HARNESS_H_6A21D9F0
+#define HARNESS_H_6A21D9F0
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * The number of calls to operator new so far, maintained by allocations.cpp.
+ */
+extern std::atomic<unsigned long> allocationCount;
+
+/**
+ * Prevents the compiler from discarding a value computed by a benchmark.
+ */
+template <typename T>
+inline void keep(const T& value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * Runs a function repeatedly after a short warm-up and prints the mean wall
+ * time and number of heap allocations per call.
+ */
+template <typename Function>
+void measure(std::string name, int iterations, Function fn)
+{
+  for (int i = 0; i < iterations / 10 + 1; i++)
+  {
+    fn();
+  }
+
+  unsigned long allocations = allocationCount.load();
+  auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < iterations; i++)
+  {
+    fn();
+  }
+
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  double perCall =
+    std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+  double allocsPerCall =
+    static_cast<double>(allocationCount.load() - allocations) / iterations;
+
+  std::cout << name << ": " << perCall << " ns/call, "
+    << allocsPerCall << " allocs/call" << std::endl;
+}
+
+/**
+ * Summary statistics for one benchmarked stage. Times are in microseconds.
+ */
+struct stage_result {
+  std::string name;
+  int iterations = 0;
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p99 = 0.0;
+  double allocations = 0.0;
+};
+
+/**
+ * Times each call of a function individually, preparing a fresh input for
+ * each call outside of the timed region.
+ */
+template <typename Prepare, typename Function>
+stage_result sample(
+  std::string name,
+  int iterations,
+  Prepare prepare,
+  Function fn)
+{
+  std::vector<double> times;
+  unsigned long allocations = 0;
+
+  for (int i = 0; i < iterations; i++)
+  {
+    auto input = prepare();
+
+    unsigned long allocationsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+
+    fn(input);
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    allocations += allocationCount.load() - allocationsBefore;
+
+    times.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+  }
+
+  stage_result result;
+  result.name = std::move(name);
+  result.iterations = iterations;
+
+  if (iterations > 0)
+  {
+    std::sort(std::begin(times), std::end(times));
+
+    double total = 0.0;
+    for (double time : times)
+    {
+      total += time;
+    }
+
+    result.mean = total / iterations;
+    result.p50 = times[(iterations - 1) * 50 / 100];
+    result.p99 = times[(iterations - 1) * 99 / 100];
+    result.allocations = static_cast<double>(allocations) / iterations;
+  }
+
+  return result;
+}
+
+/**
+ * Times each call of a function that takes no input.
+ */
+template <typename Function>
+stage_result sample(std::string name, int iterations, Function fn)
+{
+  return sample(
+    std::move(name),
+    iterations,
+    [] () { return 0; },
+    [&] (int) { fn(); });
+}
+
+inline void printResults(
+  const std::vector<stage_result>& results,
+  std::ostream& out)
+{
+  out << std::left << std::setw(24) << "stage"
+    << std::right << std::setw(8) << "iters"
+    << std::setw(12) << "mean us"
+    << std::setw(12) << "p50 us"
+    << std::setw(12) << "p99 us"
+    << std::setw(12) << "allocs" << std::endl;
+
+  for (const stage_result& result : results)
+  {
+    out << std::left << std::setw(24) << result.name
+      << std::right << std::setw(8) << result.iterations
+      << std::fixed << std::setprecision(1)
+      << std::setw(12) << result.mean
+      << std::setw(12) << result.p50
+      << std::setw(12) << result.p99
+      << std::setw(12) << result.allocations << std::endl;
+  }
+}
+
+/**
+ * Writes the results as a JSON array so that runs can be diffed. Stage names
+ * are not escaped, so they must not contain quotes or backslashes.
+ */
+inline void writeJson(
+  const std::vector<stage_result>& results,
+  std::ostream& out)
+{
+  out << "[" << std::endl;
+
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const stage_result& result = results[i];
+
+    out << "  {\"stage\": \"" << result.name << "\""
+      << ", \"iterations\": " << result.iterations
+      << std::fixed << std::setprecision(3)
+      << ", \"mean_us\": " << result.mean
+      << ", \"p50_us\": " << result.p50
+      << ", \"p99_us\": " << result.p99
+      << ", \"allocations\": " << result.allocations
+      << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+
+  out << "]" << std::endl;
+}
+
+#endif /* end of include guard: HARNESS_H_6A21D9F0 */
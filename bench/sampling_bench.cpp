@@ -0,0 +1,82 @@
+#include "harness.h"
+#include "word_pool.h"
+#include <verbly.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+  if (argc != 2)
+  {
+    std::cout << "usage: sampling_bench [verbly datafile]" << std::endl;
+    return -1;
+  }
+
+  verbly::database database(argv[1]);
+  std::mt19937 rng(0);
+
+  verbly::filter adjectives =
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::adjective);
+
+  verbly::filter verbs =
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::verb)
+    && (verbly::frame::length >= 2);
+
+  verbly::filter ingVerbs =
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::verb)
+    && (verbly::word::forms(verbly::inflection::ing_form));
+
+  std::geometric_distribution<int> adjdist(0.2);
+  std::geometric_distribution<int> verbdist(0.07);
+
+  measure("query adjective by tag count", 200, [&] () {
+    std::vector<verbly::word> result = database.words(
+      adjectives && (verbly::word::tagCount >= adjdist(rng))).all();
+    keep(result);
+  });
+
+  measure("query verb by tag count", 200, [&] () {
+    std::vector<verbly::word> result = database.words(
+      verbs && (verbly::word::tagCount >= verbdist(rng))).all();
+    keep(result);
+  });
+
+  measure("query ing-form verb", 200, [&] () {
+    verbly::word result = database.words(ingVerbs).first();
+    keep(result);
+  });
+
+  std::unique_ptr<word_pool> adjectivePool;
+  std::unique_ptr<word_pool> verbPool;
+  std::unique_ptr<word_pool> ingVerbPool;
+
+  measure("load pools (once per process)", 1, [&] () {
+    adjectivePool = std::unique_ptr<word_pool>(new word_pool(database, adjectives));
+    verbPool = std::unique_ptr<word_pool>(new word_pool(database, verbs));
+    ingVerbPool = std::unique_ptr<word_pool>(new word_pool(database, ingVerbs));
+  });
+
+  measure("sample adjective by tag count", 1000000, [&] () {
+    keep(adjectivePool->choose(adjdist(rng), rng));
+  });
+
+  measure("sample verb by tag count", 1000000, [&] () {
+    keep(verbPool->choose(verbdist(rng), rng));
+  });
+
+  measure("sample ing-form verb", 1000000, [&] () {
+    keep(ingVerbPool->choose(rng));
+  });
+
+  measure("sample adjective and load it by ID", 2000, [&] () {
+    int wordId = -1;
+    while (wordId == -1)
+    {
+      wordId = adjectivePool->choose(adjdist(rng), rng);
+    }
+
+    verbly::word result = database.words(verbly::word::id == wordId).first();
+    keep(result);
+  });
+}
@@ -0,0 +1,204 @@
+#include "harness.h"
+#include "noun_index.h"
+#include "selrestrs.h"
+#include <verbly.h>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// The selection restriction compilation used by generateStandardNoun before
+// the table and index existed, kept here as the baseline.
+verbly::filter legacySelection(
+  std::string role,
+  std::set<std::string> selrestrs)
+{
+  verbly::filter condition =
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::noun)
+    && (verbly::form::proper == false)
+    && (verbly::word::tagCount >= 1);
+
+  verbly::filter selection(true);
+
+  for (const std::string& selrestr : selrestrs)
+  {
+    if (selrestr == "concrete")
+    {
+      selection += (verbly::notion::wnid == 100001930); // physical entity
+    } else if (selrestr == "time")
+    {
+      selection += (verbly::notion::wnid == 100028270); // time
+    } else if (selrestr == "state")
+    {
+      selection += (verbly::notion::wnid == 100024720); // state
+    } else if (selrestr == "abstract")
+    {
+      selection += (verbly::notion::wnid == 100002137); // abstract entity
+    } else if (selrestr == "scalar")
+    {
+      selection += (verbly::notion::wnid == 103835412); // number
+    } else if (selrestr == "currency")
+    {
+      selection += (verbly::notion::wnid == 105050379); // currency
+    } else if (selrestr == "location")
+    {
+      selection += (verbly::notion::wnid == 100027167); // location
+    } else if (selrestr == "organization")
+    {
+      selection += (verbly::notion::wnid == 100237078); // organization
+    } else if (selrestr == "int_control")
+    {
+      selection += (verbly::notion::wnid == 100007347); // causal agent
+    } else if (selrestr == "natural")
+    {
+      selection += (verbly::notion::wnid == 100019128); // natural object
+    } else if (selrestr == "phys_obj")
+    {
+      selection += (verbly::notion::wnid == 100002684); // physical object
+    } else if (selrestr == "solid")
+    {
+      selection += (verbly::notion::wnid == 113860793); // solid
+    } else if (selrestr == "shape")
+    {
+      selection += (verbly::notion::wnid == 100027807); // shape
+    } else if (selrestr == "substance")
+    {
+      selection += (verbly::notion::wnid == 100019613); // substance
+    } else if (selrestr == "idea")
+    {
+      selection += (verbly::notion::wnid == 105803379); // idea
+    } else if (selrestr == "sound")
+    {
+      selection += (verbly::notion::wnid == 107111047); // sound
+    } else if (selrestr == "communication")
+    {
+      selection += (verbly::notion::wnid == 100033020); // communication
+    } else if (selrestr == "region")
+    {
+      selection += (verbly::notion::wnid == 105221895); // region
+    } else if (selrestr == "place")
+    {
+      selection += (verbly::notion::wnid == 100586262); // place
+    } else if (selrestr == "machine")
+    {
+      selection += (verbly::notion::wnid == 102958343); // machine
+    } else if (selrestr == "animate")
+    {
+      selection += (verbly::notion::wnid == 100004258); // animate thing
+    } else if (selrestr == "plant")
+    {
+      selection += (verbly::notion::wnid == 103956922); // plant
+    } else if (selrestr == "comestible")
+    {
+      selection += (verbly::notion::wnid == 100021265); // food
+    } else if (selrestr == "artifact")
+    {
+      selection += (verbly::notion::wnid == 100021939); // artifact
+    } else if (selrestr == "vehicle")
+    {
+      selection += (verbly::notion::wnid == 104524313); // vehicle
+    } else if (selrestr == "human")
+    {
+      selection += (verbly::notion::wnid == 100007846); // person
+    } else if (selrestr == "animal")
+    {
+      selection += (verbly::notion::wnid == 100015388); // animal
+    } else if (selrestr == "body_part")
+    {
+      selection += (verbly::notion::wnid == 105220461); // body part
+    } else if (selrestr == "garment")
+    {
+      selection += (verbly::notion::wnid == 103051540); // clothing
+    } else if (selrestr == "tool")
+    {
+      selection += (verbly::notion::wnid == 104451818); // tool
+    } else if ((selrestr == "concrete_inanimate") || (selrestr == "inanimate"))
+    {
+      selection += (verbly::notion::wnid == 100021939); // artifact
+      selection += (verbly::notion::wnid == 100019128); // natural object
+    } else if (selrestr == "non_region_location")
+    {
+      selection += (verbly::notion::wnid == 102913152); // building
+    } else if (selrestr == "non_solid_food")
+    {
+      selection += (verbly::notion::wnid == 107881800); // beverage
+    } else if (selrestr == "solid_food")
+    {
+      selection += (verbly::notion::wnid == 107555863); // solid food
+    } else if (selrestr == "slinky")
+    {
+      selection += (verbly::notion::wnid == 103670849); // line
+    }
+  }
+
+  if (selection.compact().getType() != verbly::filter::type::empty)
+  {
+    condition &= (verbly::notion::fullHypernyms %= std::move(selection));
+  } else if (role == "Attribute")
+  {
+    condition &= (verbly::notion::fullHypernyms %= (verbly::notion::wnid == 100024264)); // attribute
+  } else if (role == "Instrument")
+  {
+    condition &= (verbly::notion::fullHypernyms %= (verbly::notion::wnid == 104451818)); // tool
+  } else if (role == "Agent")
+  {
+    condition &= (verbly::notion::fullHypernyms %= (verbly::notion::wnid == 100007347)); // causal agent
+  }
+
+  return condition;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 2)
+  {
+    std::cout << "usage: selrestr_bench [verbly datafile]" << std::endl;
+    return -1;
+  }
+
+  verbly::database database(argv[1]);
+  std::mt19937 rng(0);
+
+  std::vector<std::pair<std::string, std::set<std::string>>> slots = {
+    {"Agent", {"animate", "organization"}},
+    {"Theme", {"concrete"}},
+    {"Patient", {"concrete_inanimate"}},
+    {"Instrument", {}},
+    {"Location", {"location", "region", "place"}},
+    {"Theme", {"plural", "group"}},
+    {"Attribute", {}},
+    {"Destination", {"non_region_location"}}
+  };
+
+  size_t slot = 0;
+
+  measure("legacy if/else chain filter compilation", 100000, [&] () {
+    const auto& next = slots[slot++ % slots.size()];
+    verbly::filter condition = legacySelection(next.first, next.second);
+    keep(condition);
+  });
+
+  measure("legacy query", 50, [&] () {
+    const auto& next = slots[slot++ % slots.size()];
+    verbly::word result = database.words(
+      legacySelection(next.first, next.second)).first();
+    keep(result);
+  });
+
+  measure("selrestr table lookup", 1000000, [&] () {
+    const auto& next = slots[slot++ % slots.size()];
+    for (const std::string& selrestr : next.second)
+    {
+      keep(findSelrestr(selrestr));
+    }
+  });
+
+  // Bad word filtering does not affect the timing, so a redundant condition
+  // stands in for it.
+  noun_index nouns(database, (verbly::word::tagCount >= 1));
+
+  measure("cached index selection", 1000000, [&] () {
+    const auto& next = slots[slot++ % slots.size()];
+    keep(nouns.choose(next.first, next.second, rng));
+  });
+}
@@ -0,0 +1,96 @@
+#include "bulk_generator.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+#include "sentence.h"
+#include "logger.h"
+
+bulk_generator::bulk_generator(
+  std::string configFile,
+  std::mt19937& rng) :
+    rng_(rng)
+{
+  // Load the config file.
+  YAML::Node config = YAML::LoadFile(configFile);
+
+  // Set how much to log.
+  if (config["log_level"])
+  {
+    globalLog().setLevel(parseLogLevel(config["log_level"].as<std::string>()));
+  }
+
+  // Load the vocabulary that the workers will share.
+  datafile_ = config["verbly_datafile"].as<std::string>();
+  database_ = std::unique_ptr<verbly::database>(new verbly::database(datafile_));
+  vocabulary_ = std::make_shared<vocabulary>(*database_);
+}
+
+void bulk_generator::run(int count, int threads, std::ostream& out) const
+{
+  if (threads <= 0)
+  {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  threads = std::max(1, std::min(threads, count));
+
+  std::atomic<int> remaining(count);
+  std::mutex outputMutex;
+  std::exception_ptr failure;
+  query_stats stats;
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++)
+  {
+    std::mt19937::result_type seed = rng_();
+
+    workers.emplace_back([&, seed] () {
+      try
+      {
+        verbly::database database(datafile_);
+        std::mt19937 rng(seed);
+        sentence generator(database, rng, vocabulary_);
+
+        while (remaining.fetch_sub(1) > 0)
+        {
+          std::string title = generator.generate();
+
+          std::lock_guard<std::mutex> outputLock(outputMutex);
+          out << title << '\n';
+        }
+
+        std::lock_guard<std::mutex> outputLock(outputMutex);
+        stats += generator.getQueryStats();
+      } catch (...)
+      {
+        // Stop the other workers and report the first failure.
+        remaining = 0;
+
+        std::lock_guard<std::mutex> outputLock(outputMutex);
+        if (!failure)
+        {
+          failure = std::current_exception();
+        }
+      }
+    });
+  }
+
+  for (std::thread& worker : workers)
+  {
+    worker.join();
+  }
+
+  out.flush();
+
+  if (failure)
+  {
+    std::rethrow_exception(failure);
+  }
+
+  // Titles go to out, so report elsewhere.
+  LOG(info) << "Query memo: " << stats;
+}
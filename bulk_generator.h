@@ -0,0 +1,37 @@
+#ifndef BULK_GENERATOR_H_0F6C83A2
+#define BULK_GENERATOR_H_0F6C83A2
+
+#include <verbly.h>
+#include <random>
+#include <string>
+#include <memory>
+#include <ostream>
+#include "vocabulary.h"
+
+/**
+ * Generates titles in bulk, without posting them, on several threads. Each
+ * worker has its own database connection, random engine and sentence
+ * generator, and they share one vocabulary.
+ */
+class bulk_generator {
+public:
+
+  bulk_generator(
+    std::string configFile,
+    std::mt19937& rng);
+
+  /**
+   * Writes count titles to out, one per line, using the given number of
+   * worker threads. If threads is not positive, one thread is used per core.
+   */
+  void run(int count, int threads, std::ostream& out) const;
+
+private:
+
+  std::mt19937& rng_;
+  std::string datafile_;
+  std::unique_ptr<verbly::database> database_;
+  std::shared_ptr<const vocabulary> vocabulary_;
+};
+
+#endif /* end of include guard: BULK_GENERATOR_H_0F6C83A2 */
@@ -0,0 +1,206 @@
+#include "dead_url_cache.h"
+#include "fnv.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+  const char logMagic[4] = {'A', 'D', 'V', 'D'};
+  const uint32_t logVersion = 1;
+
+  const size_t recordSize = sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint8_t);
+
+  // Sixteen bits per URL and seven probes give a false positive rate of
+  // about one in two thousand.
+  const size_t filterBitsPerUrl = 16;
+  const int filterProbes = 7;
+
+}
+
+dead_url_cache::dead_url_cache(std::string path, std::chrono::seconds ttl) :
+  path_(std::move(path)),
+  ttl_(ttl)
+{
+  load();
+}
+
+bool dead_url_cache::isDead(const char* url, size_t length) const
+{
+  uint64_t urlHash = fnv1a64(url, length);
+
+  if (!mightContain(urlHash))
+  {
+    return false;
+  }
+
+  auto found = failures_.find(urlHash);
+
+  return (found != std::end(failures_)) && (found->second.expires > now());
+}
+
+void dead_url_cache::record(const std::string& url, failure_reason reason)
+{
+  std::chrono::seconds lifetime = ttl_;
+  if (reason == failure_reason::unreachable)
+  {
+    lifetime = std::min(lifetime, std::chrono::seconds(std::chrono::hours(24)));
+  }
+
+  failure next;
+  next.expires = now() + lifetime.count();
+  next.reason = reason;
+
+  uint64_t urlHash = fnv1a64(url);
+  insert(urlHash, next);
+
+  if (log_)
+  {
+    write(log_, urlHash, next);
+    log_.flush();
+  }
+}
+
+void dead_url_cache::load()
+{
+  {
+    std::ifstream file(path_, std::ios::binary);
+
+    char magic[sizeof(logMagic)];
+    uint32_t version = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+
+    if (file
+      && std::equal(std::begin(magic), std::end(magic), std::begin(logMagic))
+      && (version == logVersion))
+    {
+      int64_t current = now();
+      char buffer[recordSize];
+
+      // Later records for a URL replace earlier ones, and a record cut short
+      // by a crash is ignored.
+      while (file.read(buffer, recordSize))
+      {
+        uint64_t urlHash;
+        failure next;
+        std::copy(buffer, buffer + 8, reinterpret_cast<char*>(&urlHash));
+        std::copy(buffer + 8, buffer + 16, reinterpret_cast<char*>(&next.expires));
+        next.reason = static_cast<failure_reason>(buffer[16]);
+
+        if (next.expires > current)
+        {
+          failures_[urlHash] = next;
+        } else {
+          failures_.erase(urlHash);
+        }
+      }
+    }
+  }
+
+  rebuildFilter(failures_.size());
+
+  // Rewrite the log without the expired and superseded records.
+  std::string tempPath = path_ + ".tmp";
+
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(logMagic, sizeof(logMagic));
+    file.write(reinterpret_cast<const char*>(&logVersion), sizeof(logVersion));
+
+    for (const auto& mapping : failures_)
+    {
+      write(file, mapping.first, mapping.second);
+    }
+
+    if (!file)
+    {
+      std::remove(tempPath.c_str());
+
+      return;
+    }
+  }
+
+  std::rename(tempPath.c_str(), path_.c_str());
+
+  log_.open(path_, std::ios::binary | std::ios::app);
+}
+
+void dead_url_cache::insert(uint64_t urlHash, const failure& next)
+{
+  failures_[urlHash] = next;
+
+  if (failures_.size() > filterCapacity_)
+  {
+    rebuildFilter(failures_.size() * 2);
+  } else {
+    addToFilter(urlHash);
+  }
+}
+
+void dead_url_cache::write(
+  std::ostream& out,
+  uint64_t urlHash,
+  const failure& next) const
+{
+  char buffer[recordSize];
+  std::copy(
+    reinterpret_cast<const char*>(&urlHash),
+    reinterpret_cast<const char*>(&urlHash) + 8,
+    buffer);
+  std::copy(
+    reinterpret_cast<const char*>(&next.expires),
+    reinterpret_cast<const char*>(&next.expires) + 8,
+    buffer + 8);
+  buffer[16] = static_cast<char>(next.reason);
+
+  out.write(buffer, recordSize);
+}
+
+bool dead_url_cache::mightContain(uint64_t urlHash) const
+{
+  // The probes are derived from the two halves of the hash.
+  uint64_t bits = filter_.size() * 64;
+  uint64_t first = urlHash & 0xFFFFFFFF;
+  uint64_t second = (urlHash >> 32) | 1;
+
+  for (int i = 0; i < filterProbes; i++)
+  {
+    uint64_t bit = (first + i * second) % bits;
+    if ((filter_[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void dead_url_cache::addToFilter(uint64_t urlHash)
+{
+  uint64_t bits = filter_.size() * 64;
+  uint64_t first = urlHash & 0xFFFFFFFF;
+  uint64_t second = (urlHash >> 32) | 1;
+
+  for (int i = 0; i < filterProbes; i++)
+  {
+    uint64_t bit = (first + i * second) % bits;
+    filter_[bit / 64] |= uint64_t(1) << (bit % 64);
+  }
+}
+
+void dead_url_cache::rebuildFilter(size_t capacity)
+{
+  filterCapacity_ = std::max(capacity, size_t(1024));
+  filter_.assign((filterCapacity_ * filterBitsPerUrl + 63) / 64, 0);
+
+  for (const auto& mapping : failures_)
+  {
+    addToFilter(mapping.first);
+  }
+}
+
+int64_t dead_url_cache::now()
+{
+  return std::chrono::duration_cast<std::chrono::seconds>(
+    clock::now().time_since_epoch()).count();
+}
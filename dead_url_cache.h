@@ -0,0 +1,82 @@
+#ifndef DEAD_URL_CACHE_H_47B2E9C8
+#define DEAD_URL_CACHE_H_47B2E9C8
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class failure_reason : uint8_t {
+  unreachable,
+  http_error,
+  not_image,
+  too_small,
+  undecodable
+};
+
+/**
+ * Remembers candidate image URLs that failed, so that later attempts at the
+ * same notion do not wait on them again. Failures are appended to a log file
+ * as they happen, and the log is compacted when it is loaded. A Bloom filter
+ * in front of the table answers most lookups, which are for URLs that have
+ * never failed, without touching it.
+ *
+ * The cache is not thread-safe; each picture finder owns its own.
+ */
+class dead_url_cache {
+public:
+
+  /**
+   * Failures expire after ttl, except for unreachable hosts, which are only
+   * remembered for a day since the problem is often temporary.
+   */
+  dead_url_cache(std::string path, std::chrono::seconds ttl);
+
+  dead_url_cache(const dead_url_cache& other) = delete;
+  dead_url_cache& operator=(const dead_url_cache& other) = delete;
+
+  bool isDead(const char* url, size_t length) const;
+
+  bool isDead(const std::string& url) const
+  {
+    return isDead(url.data(), url.length());
+  }
+
+  void record(const std::string& url, failure_reason reason);
+
+private:
+
+  using clock = std::chrono::system_clock;
+
+  struct failure {
+    int64_t expires;
+    failure_reason reason;
+  };
+
+  void load();
+
+  void insert(uint64_t urlHash, const failure& next);
+
+  void write(std::ostream& out, uint64_t urlHash, const failure& next) const;
+
+  bool mightContain(uint64_t urlHash) const;
+
+  void addToFilter(uint64_t urlHash);
+
+  void rebuildFilter(size_t capacity);
+
+  static int64_t now();
+
+  std::string path_;
+  std::chrono::seconds ttl_;
+
+  std::unordered_map<uint64_t, failure> failures_;
+  std::vector<uint64_t> filter_;
+  size_t filterCapacity_ = 0;
+
+  std::ofstream log_;
+};
+
+#endif /* end of include guard: DEAD_URL_CACHE_H_47B2E9C8 */
@@ -0,0 +1,235 @@
+#include "encoder.h"
+#include <stdexcept>
+
+namespace {
+
+  // The lowest quality the byte budget is allowed to push JPEG and WebP to.
+  const int minQuality = 30;
+
+  const int maxPngCompression = 9;
+
+  const char* magickName(output_format format)
+  {
+    switch (format)
+    {
+      case output_format::png: return "png";
+      case output_format::jpeg: return "jpeg";
+      case output_format::webp: return "webp";
+    }
+
+    return "png";
+  }
+
+  int readSetting(
+    const YAML::Node& config,
+    const std::string& key,
+    int min,
+    int max,
+    int fallback)
+  {
+    if (!config[key])
+    {
+      return fallback;
+    }
+
+    int value = config[key].as<int>();
+    if ((value < min) || (value > max))
+    {
+      throw std::invalid_argument(key + " must be from " + std::to_string(min)
+        + " to " + std::to_string(max));
+    }
+
+    return value;
+  }
+
+}
+
+output_format encoder_config::parseFormat(const std::string& name)
+{
+  if (name == "png")
+  {
+    return output_format::png;
+  } else if ((name == "jpeg") || (name == "jpg"))
+  {
+    return output_format::jpeg;
+  } else if (name == "webp")
+  {
+    return output_format::webp;
+  } else {
+    throw std::invalid_argument("Unknown output format " + name);
+  }
+}
+
+encoder_config encoder_config::read(const YAML::Node& config)
+{
+  encoder_config result;
+  if (config["output_format"])
+  {
+    result.format = parseFormat(config["output_format"].as<std::string>());
+  }
+
+  result.pngCompression = readSetting(config, "png_compression", 0, maxPngCompression, result.pngCompression);
+  result.jpegQuality = readSetting(config, "jpeg_quality", 1, 100, result.jpegQuality);
+  result.webpQuality = readSetting(config, "webp_quality", 1, 100, result.webpQuality);
+
+  if (config["output_max_kb"])
+  {
+    result.maxBytes = config["output_max_kb"].as<size_t>() * 1024;
+  }
+
+  return result;
+}
+
+encoder::encoder(encoder_config config) :
+  config_(std::move(config))
+{
+  // Encode a single pixel, so that a format that GraphicsMagick was built
+  // without is reported at startup rather than when the first post is made.
+  Magick::Image probe(Magick::Geometry(1, 1), Magick::Color("white"));
+  probe.magick(magickName(config_.format));
+
+  Magick::Blob probed;
+  try
+  {
+    probed = encodeWith(probe, (config_.format == output_format::png)
+      ? config_.pngCompression
+      : minQuality);
+  } catch (const Magick::Exception& e)
+  {
+    throw std::runtime_error(std::string("Cannot encode ")
+      + magickName(config_.format) + ": " + e.what());
+  }
+
+  if (probed.length() == 0)
+  {
+    throw std::runtime_error(std::string("Cannot encode ") + magickName(config_.format));
+  }
+}
+
+encoded_image encoder::encode(Magick::Image& pic) const
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  encoded_image result;
+
+  switch (config_.format)
+  {
+    case output_format::png:
+    {
+      result.mimeType = "image/png";
+      pic.magick(magickName(config_.format));
+
+      int low = config_.pngCompression;
+      int high = maxPngCompression;
+      result.setting = low;
+      result.data = encodeWith(pic, low);
+      result.attempts = 1;
+
+      if ((config_.maxBytes > 0) && (result.data.length() > config_.maxBytes) && (low < high))
+      {
+        // Higher levels are slower but smaller, so look for the lowest level
+        // that fits, falling back to the highest.
+        result.setting = high;
+        result.data = encodeWith(pic, high);
+        result.attempts++;
+
+        low++;
+        while (low < high)
+        {
+          int mid = low + (high - low) / 2;
+          Magick::Blob attempt = encodeWith(pic, mid);
+          result.attempts++;
+
+          if (attempt.length() <= config_.maxBytes)
+          {
+            result.setting = mid;
+            result.data = attempt;
+            high = mid;
+          } else {
+            low = mid + 1;
+          }
+        }
+      }
+
+      break;
+    }
+
+    case output_format::jpeg:
+    case output_format::webp:
+    {
+      int quality;
+      if (config_.format == output_format::jpeg)
+      {
+        result.mimeType = "image/jpeg";
+        pic.magick(magickName(config_.format));
+        quality = config_.jpegQuality;
+      } else {
+        result.mimeType = "image/webp";
+        pic.magick(magickName(config_.format));
+        quality = config_.webpQuality;
+      }
+
+      result.setting = quality;
+      result.data = encodeWith(pic, quality);
+      result.attempts = 1;
+
+      if ((config_.maxBytes > 0) && (result.data.length() > config_.maxBytes) && (quality > minQuality))
+      {
+        // Look for the highest quality that fits, falling back to the lowest.
+        int low = minQuality;
+        int high = quality - 1;
+
+        result.setting = low;
+        result.data = encodeWith(pic, low);
+        result.attempts++;
+
+        low++;
+        while (low <= high)
+        {
+          int mid = low + (high - low) / 2;
+          Magick::Blob attempt = encodeWith(pic, mid);
+          result.attempts++;
+
+          if (attempt.length() <= config_.maxBytes)
+          {
+            result.setting = mid;
+            result.data = attempt;
+            low = mid + 1;
+          } else {
+            high = mid - 1;
+          }
+        }
+      }
+
+      break;
+    }
+  }
+
+  result.elapsed = std::chrono::steady_clock::now() - start;
+
+  return result;
+}
+
+Magick::Blob encoder::encodeWith(Magick::Image& pic, int setting) const
+{
+  Magick::Blob outputimg;
+
+  if (config_.format == output_format::png)
+  {
+    // The tens digit is the zlib level, and 5 picks the PNG filter
+    // adaptively.
+    pic.quality(setting * 10 + 5);
+  } else {
+    pic.quality(setting);
+  }
+
+  try
+  {
+    pic.write(&outputimg);
+  } catch (const Magick::WarningCoder& e)
+  {
+    // Ignore
+  }
+
+  return outputimg;
+}
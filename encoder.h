@@ -0,0 +1,83 @@
+#ifndef ENCODER_H_1F6C8A35
+#define ENCODER_H_1F6C8A35
+
+#include <Magick++.h>
+#include <yaml-cpp/yaml.h>
+#include <chrono>
+#include <string>
+
+enum class output_format {
+  png,
+  jpeg,
+  webp
+};
+
+/**
+ * How rendered images are encoded, read from the config file.
+ */
+struct encoder_config {
+  output_format format = output_format::png;
+
+  // The zlib level for PNG, from 0 to 9.
+  int pngCompression = 7;
+
+  // From 1 to 100.
+  int jpegQuality = 90;
+  int webpQuality = 80;
+
+  // If nonzero, the encoder searches for a setting that keeps the output
+  // within this many bytes.
+  size_t maxBytes = 0;
+
+  /**
+   * Parses the name of a format, throwing std::invalid_argument if it is
+   * not one of png, jpeg and webp.
+   */
+  static output_format parseFormat(const std::string& name);
+
+  /**
+   * Reads the output_format, png_compression, jpeg_quality, webp_quality and
+   * output_max_kb keys, leaving the defaults for any that are missing.
+   * Throws std::invalid_argument if a setting is out of range.
+   */
+  static encoder_config read(const YAML::Node& config);
+};
+
+/**
+ * An encoded image along with what it took to produce it.
+ */
+struct encoded_image {
+  Magick::Blob data;
+  std::string mimeType;
+
+  // The compression level or quality that was used.
+  int setting = 0;
+  int attempts = 0;
+  std::chrono::duration<double> elapsed;
+};
+
+class encoder {
+public:
+
+  /**
+   * Throws std::runtime_error if GraphicsMagick cannot write the format,
+   * such as when it was built without the WebP delegate.
+   */
+  explicit encoder(encoder_config config);
+
+  /**
+   * Encodes a rendered image. With a byte budget, JPEG and WebP use the
+   * highest quality that fits, no higher than the configured one, and PNG
+   * uses the fastest compression level that fits, no lower than the
+   * configured one. If nothing fits, the smallest output is returned.
+   */
+  encoded_image encode(Magick::Image& pic) const;
+
+private:
+
+  Magick::Blob encodeWith(Magick::Image& pic, int setting) const;
+
+  encoder_config config_;
+};
+
+#endif /* end of include guard: ENCODER_H_1F6C8A35 */
@@ -0,0 +1,151 @@
+#include "fetcher.h"
+#include <algorithm>
+
+namespace {
+
+  size_t writeString(char* ptr, size_t size, size_t nmemb, void* userdata)
+  {
+    static_cast<std::string*>(userdata)->append(ptr, size * nmemb);
+
+    return size * nmemb;
+  }
+
+  double getTime(CURL* handle, CURLINFO info)
+  {
+    double result = 0.0;
+    curl_easy_getinfo(handle, info, &result);
+
+    return result;
+  }
+
+}
+
+std::ostream& operator<<(std::ostream& out, const fetch_timing& timing)
+{
+  return out << "dns " << static_cast<int>(timing.dns * 1000) << "ms"
+    << ", connect " << static_cast<int>(timing.connect * 1000) << "ms"
+    << ", tls " << static_cast<int>(timing.tls * 1000) << "ms"
+    << ", ttfb " << static_cast<int>(timing.ttfb * 1000) << "ms"
+    << ", transfer " << static_cast<int>(timing.transfer * 1000) << "ms";
+}
+
+fetcher::fetcher() :
+  share_(curl_share_init())
+{
+  curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &fetcher::lockShare);
+  curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &fetcher::unlockShare);
+  curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+}
+
+fetcher::~fetcher()
+{
+  for (CURL* handle : idle_)
+  {
+    curl_easy_cleanup(handle);
+  }
+
+  curl_share_cleanup(share_);
+}
+
+CURL* fetcher::acquire()
+{
+  CURL* handle = nullptr;
+
+  {
+    std::lock_guard<std::mutex> poolLock(poolMutex_);
+
+    if (!idle_.empty())
+    {
+      handle = idle_.back();
+      idle_.pop_back();
+    }
+  }
+
+  if (handle == nullptr)
+  {
+    handle = curl_easy_init();
+  }
+
+  curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+  curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, 30L);
+  curl_easy_setopt(handle, CURLOPT_TIMEOUT, 300L);
+  curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+
+  return handle;
+}
+
+void fetcher::release(CURL* handle)
+{
+  curl_easy_reset(handle);
+
+  std::lock_guard<std::mutex> poolLock(poolMutex_);
+  idle_.push_back(handle);
+}
+
+fetch_timing fetcher::timing(CURL* handle)
+{
+  // Curl reports each phase as the time from the start of the transfer
+  // until it ended.
+  double namelookup = getTime(handle, CURLINFO_NAMELOOKUP_TIME);
+  double connect = std::max(namelookup, getTime(handle, CURLINFO_CONNECT_TIME));
+  double appconnect = std::max(connect, getTime(handle, CURLINFO_APPCONNECT_TIME));
+  double starttransfer = std::max(appconnect, getTime(handle, CURLINFO_STARTTRANSFER_TIME));
+  double total = std::max(starttransfer, getTime(handle, CURLINFO_TOTAL_TIME));
+
+  fetch_timing result;
+  result.dns = namelookup;
+  result.connect = connect - namelookup;
+  result.tls = appconnect - connect;
+  result.ttfb = starttransfer - appconnect;
+  result.transfer = total - starttransfer;
+  result.total = total;
+
+  return result;
+}
+
+fetch_result fetcher::get(const std::string& url)
+{
+  fetch_result result;
+  CURL* handle = acquire();
+
+  curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeString);
+  curl_easy_setopt(handle, CURLOPT_WRITEDATA, &result.body);
+
+  CURLcode code = curl_easy_perform(handle);
+  if (code != CURLE_OK)
+  {
+    release(handle);
+
+    throw fetch_error(code);
+  }
+
+  curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &result.responseCode);
+
+  char* contentType = nullptr;
+  curl_easy_getinfo(handle, CURLINFO_CONTENT_TYPE, &contentType);
+  if (contentType != nullptr)
+  {
+    result.contentType = contentType;
+  }
+
+  result.timing = timing(handle);
+
+  release(handle);
+
+  return result;
+}
+
+void fetcher::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr)
+{
+  static_cast<fetcher*>(userptr)->shareLocks_[data].lock();
+}
+
+void fetcher::unlockShare(CURL*, curl_lock_data data, void* userptr)
+{
+  static_cast<fetcher*>(userptr)->shareLocks_[data].unlock();
+}
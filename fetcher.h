@@ -0,0 +1,92 @@
+#ifndef FETCHER_H_8A3C5D17
+#define FETCHER_H_8A3C5D17
+
+#include <curl/curl.h>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class fetch_error : public std::runtime_error {
+public:
+
+  explicit fetch_error(CURLcode code) :
+    std::runtime_error(curl_easy_strerror(code))
+  {
+  }
+};
+
+/**
+ * Where the time went in one fetch, in seconds.
+ */
+struct fetch_timing {
+  double dns = 0.0;
+  double connect = 0.0;
+  double tls = 0.0;
+  double ttfb = 0.0;
+  double transfer = 0.0;
+  double total = 0.0;
+};
+
+std::ostream& operator<<(std::ostream& out, const fetch_timing& timing);
+
+struct fetch_result {
+  long responseCode = 0;
+  std::string contentType;
+  std::string body;
+  fetch_timing timing;
+};
+
+/**
+ * Owns a pool of reusable curl easy handles. Every handle shares one DNS
+ * cache, connection cache and TLS session cache, so repeated fetches from the
+ * same hosts skip name resolution, connecting and the TLS handshake.
+ */
+class fetcher {
+public:
+
+  fetcher();
+
+  ~fetcher();
+
+  fetcher(const fetcher& other) = delete;
+  fetcher& operator=(const fetcher& other) = delete;
+
+  /**
+   * Takes a handle from the pool, or creates one, with the shared caches and
+   * the default timeouts set. It must be given back with release.
+   */
+  CURL* acquire();
+
+  /**
+   * Resets a handle's options and returns it to the pool. Its connections
+   * stay in the shared cache.
+   */
+  void release(CURL* handle);
+
+  /**
+   * Reads the phase timings of the last transfer a handle performed.
+   */
+  static fetch_timing timing(CURL* handle);
+
+  /**
+   * Downloads a URL into memory. Throws fetch_error if the transfer fails;
+   * HTTP error statuses are returned in the result.
+   */
+  fetch_result get(const std::string& url);
+
+private:
+
+  static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+
+  static void unlockShare(CURL* handle, curl_lock_data data, void* userptr);
+
+  CURLSH* share_;
+  std::mutex shareLocks_[CURL_LOCK_DATA_LAST];
+
+  std::mutex poolMutex_;
+  std::vector<CURL*> idle_;
+};
+
+#endif /* end of include guard: FETCHER_H_8A3C5D17 */
@@ -0,0 +1,30 @@
+#ifndef FNV_H_6D2E9B40
+#define FNV_H_6D2E9B40
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * The 64-bit FNV-1a hash, used to name things stored on disk.
+ */
+inline uint64_t fnv1a64(const void* data, size_t length)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+inline uint64_t fnv1a64(const std::string& data)
+{
+  return fnv1a64(data.data(), data.length());
+}
+
+#endif /* end of include guard: FNV_H_6D2E9B40 */
@@ -0,0 +1,283 @@
+#include "image_cache.h"
+#include "fnv.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+  const char indexMagic[4] = {'A', 'D', 'V', 'I'};
+  const uint32_t indexVersion = 1;
+
+}
+
+image_cache::image_cache(std::string directory, uint64_t maxBytes) :
+  directory_(std::move(directory)),
+  maxBytes_(maxBytes)
+{
+  if ((mkdir(directory_.c_str(), 0755) != 0) && (errno != EEXIST))
+  {
+    throw std::runtime_error("Could not create image cache " + directory_);
+  }
+
+  load();
+}
+
+image_cache::~image_cache()
+{
+  if (dirty_)
+  {
+    save();
+  }
+}
+
+bool image_cache::contains(const char* url, size_t length) const
+{
+  return byUrl_.count(fnv1a64(url, length)) > 0;
+}
+
+bool image_cache::get(const std::string& url, Magick::Blob& blob)
+{
+  auto found = byUrl_.find(fnv1a64(url));
+  if (found == std::end(byUrl_))
+  {
+    return false;
+  }
+
+  std::list<entry>::iterator it = found->second;
+
+  int fd = open(contentPath(it->contentHash).c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    erase(it);
+
+    return false;
+  }
+
+  // Read straight into memory that the blob then takes over and frees with
+  // delete[], so the file is copied only once.
+  struct stat info;
+  unsigned char* data = nullptr;
+  ssize_t total = 0;
+  if ((fstat(fd, &info) == 0)
+    && (static_cast<uint64_t>(info.st_size) == it->size)
+    && (info.st_size > 0))
+  {
+    data = new unsigned char[info.st_size];
+
+    while (total < info.st_size)
+    {
+      ssize_t got = read(fd, data + total, info.st_size - total);
+      if (got <= 0)
+      {
+        break;
+      }
+
+      total += got;
+    }
+  }
+
+  close(fd);
+
+  if ((data == nullptr) || (total != info.st_size))
+  {
+    delete[] data;
+    erase(it);
+
+    return false;
+  }
+
+  blob.updateNoCopy(data, total, Magick::Blob::NewAllocator);
+
+  entries_.splice(std::begin(entries_), entries_, it);
+  dirty_ = true;
+
+  return true;
+}
+
+void image_cache::put(const std::string& url, const std::string& data)
+{
+  uint64_t urlHash = fnv1a64(url);
+  uint64_t contentHash = fnv1a64(data);
+
+  auto found = byUrl_.find(urlHash);
+  if (found != std::end(byUrl_))
+  {
+    erase(found->second);
+  }
+
+  if (contentRefs_[contentHash] == 0)
+  {
+    // Write to a temporary file first so that a crash never leaves a partial
+    // image under the final name.
+    std::string path = contentPath(contentHash);
+    std::string tempPath = path + ".tmp";
+
+    {
+      std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+      file.write(data.data(), data.length());
+
+      if (!file)
+      {
+        contentRefs_.erase(contentHash);
+        std::remove(tempPath.c_str());
+
+        return;
+      }
+    }
+
+    std::rename(tempPath.c_str(), path.c_str());
+    totalBytes_ += data.length();
+  }
+
+  contentRefs_[contentHash]++;
+
+  entries_.push_front({urlHash, contentHash, data.length()});
+  byUrl_[urlHash] = std::begin(entries_);
+
+  // Keep the image that was just stored even if it is bigger than the bound.
+  while ((totalBytes_ > maxBytes_) && (entries_.size() > 1))
+  {
+    erase(std::prev(std::end(entries_)));
+  }
+
+  save();
+  dirty_ = false;
+}
+
+void image_cache::remove(const std::string& url)
+{
+  auto found = byUrl_.find(fnv1a64(url));
+  if (found != std::end(byUrl_))
+  {
+    erase(found->second);
+  }
+}
+
+std::string image_cache::contentPath(uint64_t contentHash) const
+{
+  std::ostringstream path;
+  path << directory_ << "/" << std::hex << std::setw(16) << std::setfill('0')
+    << contentHash << ".img";
+
+  return path.str();
+}
+
+std::string image_cache::indexPath() const
+{
+  return directory_ + "/index";
+}
+
+void image_cache::load()
+{
+  std::ifstream file(indexPath(), std::ios::binary | std::ios::ate);
+  if (!file)
+  {
+    return;
+  }
+
+  uint64_t fileSize = file.tellg();
+  file.seekg(0);
+
+  char magic[sizeof(indexMagic)];
+  uint32_t version = 0;
+  uint64_t count = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  file.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+  if (!file
+    || !std::equal(std::begin(magic), std::end(magic), std::begin(indexMagic))
+    || (version != indexVersion))
+  {
+    // An unreadable index just means starting over with an empty cache.
+    return;
+  }
+
+  // A truncated or corrupt count must not be trusted with an allocation.
+  uint64_t headerSize = sizeof(magic) + sizeof(version) + sizeof(count);
+  if ((headerSize > fileSize)
+    || (count != (fileSize - headerSize) / sizeof(entry))
+    || ((fileSize - headerSize) % sizeof(entry) != 0))
+  {
+    return;
+  }
+
+  std::vector<entry> stored(count);
+  file.read(reinterpret_cast<char*>(stored.data()), count * sizeof(entry));
+  if (!file)
+  {
+    return;
+  }
+
+  for (const entry& next : stored)
+  {
+    if (byUrl_.count(next.urlHash))
+    {
+      continue;
+    }
+
+    if (contentRefs_[next.contentHash]++ == 0)
+    {
+      totalBytes_ += next.size;
+    }
+
+    entries_.push_back(next);
+    byUrl_[next.urlHash] = std::prev(std::end(entries_));
+  }
+
+  // The bound may have been lowered since the index was written.
+  while ((totalBytes_ > maxBytes_) && !entries_.empty())
+  {
+    erase(std::prev(std::end(entries_)));
+  }
+}
+
+void image_cache::save() const
+{
+  std::vector<entry> stored(std::begin(entries_), std::end(entries_));
+  uint64_t count = stored.size();
+
+  std::string tempPath = indexPath() + ".tmp";
+
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(indexMagic, sizeof(indexMagic));
+    file.write(reinterpret_cast<const char*>(&indexVersion), sizeof(indexVersion));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(stored.data()), count * sizeof(entry));
+
+    if (!file)
+    {
+      std::remove(tempPath.c_str());
+
+      return;
+    }
+  }
+
+  std::rename(tempPath.c_str(), indexPath().c_str());
+}
+
+void image_cache::erase(std::list<entry>::iterator it)
+{
+  auto ref = contentRefs_.find(it->contentHash);
+  if ((ref != std::end(contentRefs_)) && (--ref->second <= 0))
+  {
+    std::remove(contentPath(it->contentHash).c_str());
+    totalBytes_ -= it->size;
+    contentRefs_.erase(ref);
+  }
+
+  byUrl_.erase(it->urlHash);
+  entries_.erase(it);
+  dirty_ = true;
+}
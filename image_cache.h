@@ -0,0 +1,83 @@
+#ifndef IMAGE_CACHE_H_C4F7A2E1
+#define IMAGE_CACHE_H_C4F7A2E1
+
+#include <Magick++.h>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+/**
+ * A size-bounded cache on disk of images that have already been downloaded
+ * and found usable, looked up by URL. The images are stored in files named
+ * after the hash of their contents, so a picture served from several URLs is
+ * only stored once. An index file holding the hashes in least recently used
+ * order is read at startup and rewritten as the cache changes.
+ *
+ * The cache is not thread-safe; each picture finder owns its own.
+ */
+class image_cache {
+public:
+
+  image_cache(std::string directory, uint64_t maxBytes);
+
+  ~image_cache();
+
+  image_cache(const image_cache& other) = delete;
+  image_cache& operator=(const image_cache& other) = delete;
+
+  /**
+   * Returns whether a URL is in the index, without touching the disk or the
+   * recency order.
+   */
+  bool contains(const char* url, size_t length) const;
+
+  /**
+   * Reads the cached image for a URL into blob, and marks it as recently
+   * used. Returns false if the URL is not cached.
+   */
+  bool get(const std::string& url, Magick::Blob& blob);
+
+  /**
+   * Stores the image downloaded from a URL, evicting the least recently used
+   * images until the cache fits in its size bound again.
+   */
+  void put(const std::string& url, const std::string& data);
+
+  /**
+   * Forgets a URL, for instance because its cached image turned out to be
+   * unreadable.
+   */
+  void remove(const std::string& url);
+
+private:
+
+  struct entry {
+    uint64_t urlHash;
+    uint64_t contentHash;
+    uint64_t size;
+  };
+
+  std::string contentPath(uint64_t contentHash) const;
+
+  std::string indexPath() const;
+
+  void load();
+
+  void save() const;
+
+  void erase(std::list<entry>::iterator it);
+
+  std::string directory_;
+  uint64_t maxBytes_;
+  uint64_t totalBytes_ = 0;
+
+  // Most recently used first.
+  std::list<entry> entries_;
+  std::unordered_map<uint64_t, std::list<entry>::iterator> byUrl_;
+  std::map<uint64_t, int> contentRefs_;
+  bool dirty_ = false;
+};
+
+#endif /* end of include guard: IMAGE_CACHE_H_C4F7A2E1 */
@@ -0,0 +1,169 @@
+#include "image_header.h"
+#include <cstring>
+
+namespace {
+
+  unsigned int bigEndian16(const unsigned char* data)
+  {
+    return (data[0] << 8) | data[1];
+  }
+
+  unsigned int bigEndian32(const unsigned char* data)
+  {
+    return (static_cast<unsigned int>(data[0]) << 24)
+      | (data[1] << 16)
+      | (data[2] << 8)
+      | data[3];
+  }
+
+  unsigned int littleEndian16(const unsigned char* data)
+  {
+    return data[0] | (data[1] << 8);
+  }
+
+  header_status sniffPng(
+    const unsigned char* data,
+    size_t length,
+    unsigned int& width,
+    unsigned int& height)
+  {
+    // The IHDR chunk must come first, straight after the signature.
+    if (length < 24)
+    {
+      return header_status::incomplete;
+    }
+
+    if (std::memcmp(data + 12, "IHDR", 4) != 0)
+    {
+      return header_status::unknown;
+    }
+
+    width = bigEndian32(data + 16);
+    height = bigEndian32(data + 20);
+
+    return header_status::found;
+  }
+
+  header_status sniffGif(
+    const unsigned char* data,
+    size_t length,
+    unsigned int& width,
+    unsigned int& height)
+  {
+    // The logical screen descriptor follows the six byte signature.
+    if (length < 10)
+    {
+      return header_status::incomplete;
+    }
+
+    width = littleEndian16(data + 6);
+    height = littleEndian16(data + 8);
+
+    return header_status::found;
+  }
+
+  header_status sniffJpeg(
+    const unsigned char* data,
+    size_t length,
+    unsigned int& width,
+    unsigned int& height)
+  {
+    // Walk the marker segments after SOI until a start of frame.
+    size_t pos = 2;
+
+    for (;;)
+    {
+      if (pos >= length)
+      {
+        return header_status::incomplete;
+      }
+
+      if (data[pos] != 0xFF)
+      {
+        return header_status::unknown;
+      }
+
+      // Markers can be preceded by any number of fill bytes.
+      while ((pos < length) && (data[pos] == 0xFF))
+      {
+        pos++;
+      }
+
+      if (pos >= length)
+      {
+        return header_status::incomplete;
+      }
+
+      unsigned char marker = data[pos++];
+
+      if ((marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD7)))
+      {
+        // Standalone markers have no length.
+        continue;
+      }
+
+      if ((marker == 0xD9) || (marker == 0xDA))
+      {
+        // End of image or start of scan before any frame header.
+        return header_status::unknown;
+      }
+
+      if (pos + 2 > length)
+      {
+        return header_status::incomplete;
+      }
+
+      size_t segmentLength = bigEndian16(data + pos);
+      if (segmentLength < 2)
+      {
+        return header_status::unknown;
+      }
+
+      bool startOfFrame = (marker >= 0xC0) && (marker <= 0xCF)
+        && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC);
+
+      if (startOfFrame)
+      {
+        // Length, precision, then height and width.
+        if (pos + 7 > length)
+        {
+          return header_status::incomplete;
+        }
+
+        height = bigEndian16(data + pos + 3);
+        width = bigEndian16(data + pos + 5);
+
+        return header_status::found;
+      }
+
+      pos += segmentLength;
+    }
+  }
+
+}
+
+header_status sniffDimensions(
+  const unsigned char* data,
+  size_t length,
+  unsigned int& width,
+  unsigned int& height)
+{
+  if (length < 8)
+  {
+    return header_status::incomplete;
+  }
+
+  if (std::memcmp(data, "\x89PNG\r\n\x1A\n", 8) == 0)
+  {
+    return sniffPng(data, length, width, height);
+  } else if ((std::memcmp(data, "GIF87a", 6) == 0)
+    || (std::memcmp(data, "GIF89a", 6) == 0))
+  {
+    return sniffGif(data, length, width, height);
+  } else if ((data[0] == 0xFF) && (data[1] == 0xD8))
+  {
+    return sniffJpeg(data, length, width, height);
+  } else {
+    return header_status::unknown;
+  }
+}
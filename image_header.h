@@ -0,0 +1,24 @@
+#ifndef IMAGE_HEADER_H_5B8F1E94
+#define IMAGE_HEADER_H_5B8F1E94
+
+#include <cstddef>
+
+enum class header_status {
+  incomplete,
+  found,
+  unknown
+};
+
+/**
+ * Reads the dimensions of a JPEG, PNG or GIF image from as much of the start
+ * of the file as has been downloaded, without decoding it. Returns
+ * incomplete if more data is needed, and unknown if the data is not in one
+ * of those formats or the header could not be parsed.
+ */
+header_status sniffDimensions(
+  const unsigned char* data,
+  size_t length,
+  unsigned int& width,
+  unsigned int& height);
+
+#endif /* end of include guard: IMAGE_HEADER_H_5B8F1E94 */
@@ -0,0 +1,397 @@
+#include "image_prober.h"
+#include "image_header.h"
+#include "metrics.h"
+#include "trace.h"
+#include "logger.h"
+#include <curl/curl.h>
+#include <atomic>
+#include <list>
+
+namespace {
+
+  struct transfer {
+    CURL* handle = nullptr;
+    std::string url;
+    std::string body;
+    unsigned int minWidth = 0;
+    header_status header = header_status::incomplete;
+    bool tooSmall = false;
+    unsigned long id = 0;
+    tracer::clock::time_point started;
+  };
+
+  size_t writeBody(char* ptr, size_t size, size_t nmemb, void* userdata)
+  {
+    transfer& current = *static_cast<transfer*>(userdata);
+    current.body.append(ptr, size * nmemb);
+
+    // Give up on the image as soon as its header shows it is too small,
+    // rather than downloading and decoding the rest of it.
+    if (current.header == header_status::incomplete)
+    {
+      unsigned int width = 0;
+      unsigned int height = 0;
+
+      current.header = sniffDimensions(
+        reinterpret_cast<const unsigned char*>(current.body.data()),
+        current.body.length(),
+        width,
+        height);
+
+      if ((current.header == header_status::found)
+        && ((width < current.minWidth) || (height == 0)))
+      {
+        current.tooSmall = true;
+
+        // Returning less than was given aborts the transfer.
+        return 0;
+      }
+    }
+
+    return size * nmemb;
+  }
+
+  // A size hint makes the JPEG decoder use DCT scaling, so the image comes
+  // out at the smallest scale that is still at least that size in both
+  // directions. Other formats ignore it.
+  void decode(
+    const Magick::Blob& data,
+    const Magick::Geometry& size,
+    Magick::Image& pic)
+  {
+    stage_timer timer(stage::decode);
+    trace_span span("decode", "image");
+
+    pic.size(size);
+    pic.read(data);
+  }
+
+  // Each attempt to fetch an image is drawn on its own track in the trace,
+  // since several are in flight at once.
+  std::atomic<unsigned long> nextTransferId(1);
+
+  void traceAttempt(const transfer& done, std::string outcome)
+  {
+    if (tracer::enabled())
+    {
+      tracer::asynchronous(
+        "image_fetch",
+        "image",
+        done.id,
+        done.started,
+        tracer::clock::now(),
+        {{"url", done.url}, {"outcome", std::move(outcome)}});
+    }
+  }
+
+  // Owns the multi handle and its transfers, and cancels whatever is still
+  // in flight when it goes out of scope.
+  class multi_session {
+  public:
+
+    explicit multi_session(fetcher& fetch) :
+      fetcher_(fetch),
+      multi_(curl_multi_init())
+    {
+      // Accept string from Google Chrome
+      headers_ = curl_slist_append(headers_, "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8");
+    }
+
+    ~multi_session()
+    {
+      while (!transfers_.empty())
+      {
+        traceAttempt(transfers_.front(), "cancelled");
+        finish(transfers_.front());
+      }
+
+      curl_slist_free_all(headers_);
+      curl_multi_cleanup(multi_);
+    }
+
+    multi_session(const multi_session& other) = delete;
+    multi_session& operator=(const multi_session& other) = delete;
+
+    size_t size() const
+    {
+      return transfers_.size();
+    }
+
+    void start(std::string url, unsigned int minWidth)
+    {
+      transfers_.emplace_back();
+      transfer& next = transfers_.back();
+      next.url = std::move(url);
+      next.minWidth = minWidth;
+      next.handle = fetcher_.acquire();
+      next.id = nextTransferId++;
+      next.started = tracer::clock::now();
+
+      curl_easy_setopt(next.handle, CURLOPT_HTTPHEADER, headers_);
+      curl_easy_setopt(next.handle, CURLOPT_URL, next.url.c_str());
+      curl_easy_setopt(next.handle, CURLOPT_WRITEFUNCTION, writeBody);
+      curl_easy_setopt(next.handle, CURLOPT_WRITEDATA, &next);
+      curl_easy_setopt(next.handle, CURLOPT_PRIVATE, &next);
+
+      curl_multi_add_handle(multi_, next.handle);
+    }
+
+    /**
+     * Drives the transfers until at least one has completed or the timeout
+     * elapses, and returns the completed one along with its result, or
+     * nullptr if none have completed yet.
+     */
+    transfer* next(CURLcode& result)
+    {
+      int running = 0;
+      curl_multi_perform(multi_, &running);
+
+      int queued = 0;
+      CURLMsg* msg = nullptr;
+      while ((msg = curl_multi_info_read(multi_, &queued)) != nullptr)
+      {
+        if (msg->msg == CURLMSG_DONE)
+        {
+          transfer* done = nullptr;
+          curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &done);
+          result = msg->data.result;
+
+          return done;
+        }
+      }
+
+      curl_multi_wait(multi_, nullptr, 0, 1000, nullptr);
+
+      return nullptr;
+    }
+
+    void finish(transfer& done)
+    {
+      curl_multi_remove_handle(multi_, done.handle);
+      fetcher_.release(done.handle);
+
+      for (auto it = std::begin(transfers_); it != std::end(transfers_); it++)
+      {
+        if (&*it == &done)
+        {
+          transfers_.erase(it);
+
+          break;
+        }
+      }
+    }
+
+  private:
+
+    fetcher& fetcher_;
+    CURLM* multi_;
+    curl_slist* headers_ = nullptr;
+    std::list<transfer> transfers_;
+  };
+
+}
+
+image_prober::image_prober(
+  fetcher& fetch,
+  image_cache* cache,
+  dead_url_cache* deadUrls,
+  size_t concurrency) :
+    fetcher_(fetch),
+    cache_(cache),
+    deadUrls_(deadUrls),
+    concurrency_(concurrency > 0 ? concurrency : 1)
+{
+}
+
+bool image_prober::probe(
+  const url_list& urls,
+  const std::vector<size_t>& order,
+  unsigned int minWidth,
+  const Magick::Geometry& decodeSize,
+  std::string& foundUrl,
+  Magick::Image& pic) const
+{
+  // A cached image skips the network entirely, so look for one before any
+  // transfer is started.
+  if (cache_ != nullptr)
+  {
+    for (size_t i : order)
+    {
+      if (cache_->contains(urls.data(i), urls.length(i)))
+      {
+        std::string url = urls[i];
+
+        if (readCached(url, minWidth, decodeSize, pic))
+        {
+          foundUrl = url;
+
+          return true;
+        }
+      }
+    }
+  }
+
+  multi_session session(fetcher_);
+  std::vector<size_t>::const_iterator next = std::begin(order);
+
+  for (;;)
+  {
+    while ((session.size() < concurrency_) && (next != std::end(order)))
+    {
+      session.start(urls[*next++], minWidth);
+    }
+
+    if (session.size() == 0)
+    {
+      return false;
+    }
+
+    CURLcode result = CURLE_OK;
+    transfer* done = session.next(result);
+    if (done == nullptr)
+    {
+      continue;
+    }
+
+    globalMetrics().observe(
+      stage::image_fetch,
+      std::chrono::duration<double>(fetcher::timing(done->handle).total));
+
+    if (done->tooSmall)
+    {
+      traceAttempt(*done, "too small");
+      recordFailure(done->url, failure_reason::too_small);
+      session.finish(*done);
+
+      continue;
+    }
+
+    if (result != CURLE_OK)
+    {
+      LOG(info) << done->url << ": " << curl_easy_strerror(result);
+
+      traceAttempt(*done, curl_easy_strerror(result));
+
+      recordFailure(done->url, failure_reason::unreachable);
+      session.finish(*done);
+
+      continue;
+    }
+
+    long responseCode = 0;
+    curl_easy_getinfo(done->handle, CURLINFO_RESPONSE_CODE, &responseCode);
+
+    char* contentType = nullptr;
+    curl_easy_getinfo(done->handle, CURLINFO_CONTENT_TYPE, &contentType);
+
+    if (responseCode != 200)
+    {
+      traceAttempt(*done, "HTTP " + std::to_string(responseCode));
+
+      // Server errors are often temporary, unlike a missing page.
+      recordFailure(
+        done->url,
+        (responseCode >= 500) ? failure_reason::unreachable : failure_reason::http_error);
+      session.finish(*done);
+
+      continue;
+    }
+
+    if ((contentType == nullptr)
+      || (std::string(contentType).substr(0, 6) != "image/"))
+    {
+      traceAttempt(*done, "not an image");
+      recordFailure(done->url, failure_reason::not_image);
+      session.finish(*done);
+
+      continue;
+    }
+
+    std::string url = done->url;
+    std::string body = std::move(done->body);
+    fetch_timing timing = fetcher::timing(done->handle);
+    traceAttempt(*done, "fetched");
+    session.finish(*done);
+
+    Magick::Blob img(body.data(), body.length());
+
+    try
+    {
+      decode(img, decodeSize, pic);
+
+      if ((pic.rows() > 0) && (pic.columns() >= minWidth))
+      {
+        LOG(info) << url;
+        LOG(info) << "Fetched image (" << timing << ")";
+        foundUrl = url;
+
+        if (cache_ != nullptr)
+        {
+          cache_->put(url, body);
+        }
+
+        // The session cancels the remaining transfers.
+        return true;
+      }
+
+      recordFailure(url, failure_reason::too_small);
+    } catch (const Magick::ErrorOption& e)
+    {
+      // Occurs when the the data downloaded from the server is malformed
+      LOG(warning) << "Magick: " << e.what();
+
+      recordFailure(url, failure_reason::undecodable);
+    }
+  }
+}
+
+bool image_prober::readCached(
+  const std::string& url,
+  unsigned int minWidth,
+  const Magick::Geometry& decodeSize,
+  Magick::Image& pic) const
+{
+  trace_span span("image_cache", "image");
+
+  if (span.active())
+  {
+    span.annotate("url", url);
+  }
+
+  Magick::Blob img;
+  if (!cache_->get(url, img))
+  {
+    return false;
+  }
+
+  try
+  {
+    decode(img, decodeSize, pic);
+
+    if ((pic.rows() > 0) && (pic.columns() >= minWidth))
+    {
+      LOG(info) << url << " (cached)";
+
+      return true;
+    }
+  } catch (const Magick::Exception& e)
+  {
+    LOG(warning) << "Magick: " << e.what();
+  }
+
+  // The image was usable when it was stored, so something has happened to
+  // the file.
+  cache_->remove(url);
+
+  return false;
+}
+
+void image_prober::recordFailure(
+  const std::string& url,
+  failure_reason reason) const
+{
+  if (deadUrls_ != nullptr)
+  {
+    deadUrls_->record(url, reason);
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef IMAGE_PROBER_H_71D3A6C0
+#define IMAGE_PROBER_H_71D3A6C0
+
+#include <Magick++.h>
+#include <string>
+#include <vector>
+#include "fetcher.h"
+#include "image_cache.h"
+#include "dead_url_cache.h"
+#include "url_list_cache.h"
+
+/**
+ * Downloads candidate image URLs several at a time through a curl multi
+ * handle and keeps the first one that turns out to be usable. Transfers of
+ * images whose headers show that they are too narrow are abandoned as soon
+ * as the header arrives. Handles come from a fetcher, so connections to hosts
+ * that were seen before are reused.
+ */
+class image_prober {
+public:
+
+  /**
+   * At most concurrency transfers are in flight at once. A concurrency of
+   * one tries the URLs strictly in order. If a cache is given, URLs found in
+   * it are read from disk instead of being downloaded, and usable images
+   * that were downloaded are added to it. If deadUrls is given, URLs that
+   * fail are recorded in it.
+   */
+  image_prober(
+    fetcher& fetch,
+    image_cache* cache,
+    dead_url_cache* deadUrls,
+    size_t concurrency);
+
+  /**
+   * Tries the URLs of the list in the given order until one is an image at
+   * least minWidth pixels wide, which is decoded into pic. Cached URLs are
+   * tried first, and the network is only used if none of them is usable.
+   * JPEGs are scaled down as they are decoded, to the smallest size that
+   * still covers decodeSize. Transfers still in flight at that point are
+   * cancelled, and URLs that were never reached are never copied out of the
+   * list. Returns false if every URL failed.
+   */
+  bool probe(
+    const url_list& urls,
+    const std::vector<size_t>& order,
+    unsigned int minWidth,
+    const Magick::Geometry& decodeSize,
+    std::string& foundUrl,
+    Magick::Image& pic) const;
+
+private:
+
+  bool readCached(
+    const std::string& url,
+    unsigned int minWidth,
+    const Magick::Geometry& decodeSize,
+    Magick::Image& pic) const;
+
+  void recordFailure(const std::string& url, failure_reason reason) const;
+
+  fetcher& fetcher_;
+  image_cache* cache_;
+  dead_url_cache* deadUrls_;
+  size_t concurrency_;
+};
+
+#endif /* end of include guard: IMAGE_PROBER_H_71D3A6C0 */
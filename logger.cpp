@@ -0,0 +1,203 @@
+#include "logger.h"
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+log_level parseLogLevel(const std::string& name)
+{
+  if (name == "debug")
+  {
+    return log_level::debug;
+  } else if (name == "info")
+  {
+    return log_level::info;
+  } else if (name == "warning")
+  {
+    return log_level::warning;
+  } else if (name == "error")
+  {
+    return log_level::error;
+  } else {
+    throw std::invalid_argument("Unknown log level " + name);
+  }
+}
+
+logger::logger() :
+  out_(&std::cout)
+{
+  for (size_t i = 0; i < capacity; i++)
+  {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  thread_ = std::thread(&logger::run, this);
+}
+
+logger::~logger()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+
+  wake_.notify_all();
+  thread_.join();
+}
+
+void logger::redirect(std::ostream& out)
+{
+  flush();
+
+  std::lock_guard<std::mutex> outputLock(outputMutex_);
+  out_ = &out;
+}
+
+void logger::write(log_level level, std::string message)
+{
+  // A bounded multi-producer queue in the style of Vyukov's: each slot's
+  // sequence number says whether it is free for the position being claimed.
+  size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+  slot* claimed = nullptr;
+
+  while (claimed == nullptr)
+  {
+    slot& candidate = slots_[pos % capacity];
+    size_t sequence = candidate.sequence.load(std::memory_order_acquire);
+
+    if (sequence == pos)
+    {
+      if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        claimed = &candidate;
+      }
+    } else if (sequence < pos)
+    {
+      // The ring is full, so wait for the writer to free this slot.
+      std::unique_lock<std::mutex> lock(mutex_);
+      wakeRequested_ = true;
+      wake_.notify_one();
+
+      written_.wait(lock, [&] () {
+        return candidate.sequence.load(std::memory_order_acquire) >= pos;
+      });
+
+      pos = enqueuePos_.load(std::memory_order_relaxed);
+    } else {
+      pos = enqueuePos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  claimed->level = level;
+  claimed->message = std::move(message);
+  claimed->sequence.store(pos + 1, std::memory_order_release);
+
+  if (level >= log_level::error)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakeRequested_ = true;
+    wake_.notify_one();
+  }
+}
+
+void logger::flush()
+{
+  size_t target = enqueuePos_.load(std::memory_order_acquire);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  wakeRequested_ = true;
+  wake_.notify_one();
+
+  // The writer reports a batch only once it has been written out.
+  written_.wait(lock, [&] () {
+    return writtenPos_ >= target;
+  });
+}
+
+bool logger::pop(log_level& level, std::string& message)
+{
+  size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+  slot& next = slots_[pos % capacity];
+
+  if (next.sequence.load(std::memory_order_acquire) != pos + 1)
+  {
+    return false;
+  }
+
+  level = next.level;
+  message = std::move(next.message);
+  next.message.clear();
+
+  next.sequence.store(pos + capacity, std::memory_order_release);
+
+  // Only this thread dequeues, so the position does not need a CAS.
+  dequeuePos_.store(pos + 1, std::memory_order_release);
+
+  return true;
+}
+
+void logger::run()
+{
+  log_level level;
+  std::string message;
+
+  for (;;)
+  {
+    bool stopping;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      // Most messages are queued without taking the lock, so nothing wakes
+      // the writer for them; polling bounds how long they wait.
+      wake_.wait_for(lock, std::chrono::milliseconds(50), [this] () {
+        return stopping_ || wakeRequested_;
+      });
+
+      wakeRequested_ = false;
+      stopping = stopping_;
+    }
+
+    {
+      std::lock_guard<std::mutex> outputLock(outputMutex_);
+
+      bool wrote = false;
+      while (pop(level, message))
+      {
+        switch (level)
+        {
+          case log_level::debug: *out_ << "debug: "; break;
+          case log_level::warning: *out_ << "warning: "; break;
+          case log_level::error: *out_ << "error: "; break;
+          case log_level::info: break;
+        }
+
+        *out_ << message << '\n';
+        wrote = true;
+      }
+
+      if (wrote)
+      {
+        out_->flush();
+      }
+    }
+
+    // Let flush and any producer waiting for room know how far it got.
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      writtenPos_ = dequeuePos_.load(std::memory_order_relaxed);
+    }
+
+    written_.notify_all();
+
+    if (stopping)
+    {
+      return;
+    }
+  }
+}
+
+logger& globalLog()
+{
+  static logger instance;
+
+  return instance;
+}
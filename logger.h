@@ -0,0 +1,158 @@
+#ifndef LOGGER_H_9B3E57A0
+#define LOGGER_H_9B3E57A0
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+enum class log_level {
+  debug,
+  info,
+  warning,
+  error
+};
+
+/**
+ * Parses a level as written in the config file. Throws std::invalid_argument
+ * if the name is not recognized.
+ */
+log_level parseLogLevel(const std::string& name);
+
+/**
+ * Debug messages are only compiled in when ADVICE_DEBUG_LOG is defined, so
+ * that they cost nothing at all in a normal build.
+ */
+#ifdef ADVICE_DEBUG_LOG
+constexpr log_level compiledLogLevel = log_level::debug;
+#else
+constexpr log_level compiledLogLevel = log_level::info;
+#endif
+
+/**
+ * Writes messages from any thread without blocking on the output. Messages
+ * are queued in a fixed-size lock-free ring and written in batches by a
+ * background thread, which flushes the output once per batch rather than
+ * once per line.
+ */
+class logger {
+public:
+
+  logger();
+
+  ~logger();
+
+  logger(const logger& other) = delete;
+  logger& operator=(const logger& other) = delete;
+
+  bool enabled(log_level level) const
+  {
+    return level >= level_.load(std::memory_order_relaxed);
+  }
+
+  void setLevel(log_level level)
+  {
+    level_ = level;
+  }
+
+  /**
+   * Switches the output to another stream, after writing everything already
+   * queued to the current one. The stream must outlive the logger.
+   */
+  void redirect(std::ostream& out);
+
+  /**
+   * Queues a message. If the ring is full, waits for the writer to make
+   * room rather than losing the message.
+   */
+  void write(log_level level, std::string message);
+
+  /**
+   * Waits until everything queued so far has been written.
+   */
+  void flush();
+
+private:
+
+  static const size_t capacity = 4096;
+
+  struct slot {
+    std::atomic<size_t> sequence;
+    log_level level;
+    std::string message;
+  };
+
+  bool pop(log_level& level, std::string& message);
+
+  void run();
+
+  std::atomic<log_level> level_ {log_level::info};
+
+  std::array<slot, capacity> slots_;
+  std::atomic<size_t> enqueuePos_ {0};
+  std::atomic<size_t> dequeuePos_ {0};
+
+  // Only the writer thread and redirect use the output.
+  std::mutex outputMutex_;
+  std::ostream* out_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable written_;
+  bool wakeRequested_ = false;
+  size_t writtenPos_ = 0;
+  bool stopping_ = false;
+
+  std::thread thread_;
+};
+
+/**
+ * The logger for the whole process.
+ */
+logger& globalLog();
+
+/**
+ * Collects one message and queues it when it goes out of scope. Use it
+ * through the LOG macro, so that the message is not even formatted when its
+ * level is disabled.
+ */
+class log_line {
+public:
+
+  explicit log_line(log_level level) : level_(level)
+  {
+  }
+
+  ~log_line()
+  {
+    globalLog().write(level_, message_.str());
+  }
+
+  log_line(const log_line& other) = delete;
+  log_line& operator=(const log_line& other) = delete;
+
+  template <typename T>
+  log_line& operator<<(const T& value)
+  {
+    message_ << value;
+
+    return *this;
+  }
+
+private:
+
+  log_level level_;
+  std::ostringstream message_;
+};
+
+#define LOG(level) \
+  if ((log_level::level < compiledLogLevel) \
+    || !globalLog().enabled(log_level::level)) {} \
+  else log_line(log_level::level)
+
+#endif /* end of include guard: LOGGER_H_9B3E57A0 */
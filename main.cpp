@@ -1,19 +1,129 @@
 #include "advice.h"
+#include "bulk_generator.h"
+#include "batch_renderer.h"
+#include "trace.h"
+#include "logger.h"
+#include <cstdlib>
+#include <stdexcept>
+#include <curl/curl.h>
 
 int main(int argc, char** argv)
 {
   Magick::InitializeMagick(nullptr);
+  curl_global_init(CURL_GLOBAL_DEFAULT);
 
   std::random_device random_device;
   std::mt19937 random_engine{random_device()};
 
-  if (argc != 2)
+  std::string usage = "usage: advice [configfile] [--generate N | --render DIR_IN DIR_OUT] [--threads T] [--trace FILE]";
+
+  if (argc < 2)
   {
-    std::cout << "usage: advice [configfile]" << std::endl;
+    std::cout << usage << std::endl;
     return -1;
   }
 
   std::string configfile(argv[1]);
+  int generateCount = 0;
+  bool generateGiven = false;
+  std::string renderInput;
+  std::string renderOutput;
+  int threads = 0;
+  bool threadsGiven = false;
+  std::string tracefile;
+
+  try
+  {
+    for (int i = 2; i < argc; i++)
+    {
+      std::string arg(argv[i]);
+
+      if ((arg == "--generate") && (i + 1 < argc))
+      {
+        generateCount = std::stoi(argv[++i]);
+        generateGiven = true;
+
+        if (generateCount < 1)
+        {
+          throw std::invalid_argument(arg);
+        }
+      } else if ((arg == "--render") && (i + 2 < argc))
+      {
+        renderInput = argv[++i];
+        renderOutput = argv[++i];
+      } else if ((arg == "--threads") && (i + 1 < argc))
+      {
+        threads = std::stoi(argv[++i]);
+        threadsGiven = true;
+      } else if ((arg == "--trace") && (i + 1 < argc))
+      {
+        tracefile = argv[++i];
+      } else {
+        throw std::invalid_argument(arg);
+      }
+    }
+  } catch (const std::logic_error& ex)
+  {
+    std::cout << usage << std::endl;
+    return -1;
+  }
+
+  // Only bulk generation and rendering use worker threads.
+  if ((generateGiven && !renderInput.empty())
+    || (threadsGiven && !generateGiven && renderInput.empty()))
+  {
+    std::cout << usage << std::endl;
+    return -1;
+  }
+
+  if (!tracefile.empty())
+  {
+    try
+    {
+      tracer::start(tracefile);
+    } catch (const std::exception& ex)
+    {
+      std::cout << ex.what() << std::endl;
+      return -1;
+    }
+
+    // The bot only stops when it fails, so finish the trace however main
+    // returns.
+    std::atexit(tracer::stop);
+  }
+
+  if (!renderInput.empty())
+  {
+    try
+    {
+      batch_renderer batch(configfile, random_engine);
+      batch.run(renderInput, renderOutput, threads);
+    } catch (const std::exception& ex)
+    {
+      LOG(error) << "Error rendering images: " << ex.what();
+      return -1;
+    }
+
+    return 0;
+  }
+
+  if (generateGiven)
+  {
+    // Titles go to stdout, so report errors elsewhere.
+    globalLog().redirect(std::clog);
+
+    try
+    {
+      bulk_generator generator(configfile, random_engine);
+      generator.run(generateCount, threads, std::cout);
+    } catch (const std::exception& ex)
+    {
+      LOG(error) << "Error generating titles: " << ex.what();
+      return -1;
+    }
+
+    return 0;
+  }
 
   try
   {
@@ -24,10 +134,10 @@ int main(int argc, char** argv)
       bot.run();
     } catch (const std::exception& ex)
     {
-      std::cout << "Error running bot: " << ex.what() << std::endl;
+      LOG(error) << "Error running bot: " << ex.what();
     }
   } catch (const std::exception& ex)
   {
-    std::cout << "Error initializing bot: " << ex.what() << std::endl;
+    LOG(error) << "Error initializing bot: " << ex.what();
   }
 }
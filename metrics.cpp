@@ -0,0 +1,162 @@
+#include "metrics.h"
+#include "logger.h"
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+  const char* stageNames[] = {
+    "noun_query",
+    "url_list_fetch",
+    "image_fetch",
+    "decode",
+    "generate",
+    "layout",
+    "draw",
+    "encode",
+    "upload",
+    "post"
+  };
+
+  const char* failureNames[] = {
+    "could_not_get_images",
+    "image_error",
+    "twitter_error"
+  };
+
+  // Upper bounds in seconds. Image fetches can take minutes, while layout
+  // takes well under a millisecond.
+  const double bucketBounds[] = {
+    0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 120
+  };
+
+}
+
+static_assert(
+  sizeof(bucketBounds) / sizeof(bucketBounds[0]) == 14,
+  "bucketBounds must match bucketCount");
+
+const size_t metrics::stageCount;
+const size_t metrics::failureCount;
+const size_t metrics::bucketCount;
+
+void metrics::observe(stage which, std::chrono::duration<double> elapsed)
+{
+  histogram& target = stages_[static_cast<size_t>(which)];
+
+  size_t bucket = 0;
+  while ((bucket < bucketCount) && (elapsed.count() > bucketBounds[bucket]))
+  {
+    bucket++;
+  }
+
+  target.buckets[bucket]++;
+  target.microseconds += static_cast<uint64_t>(elapsed.count() * 1000000);
+}
+
+void metrics::countFailure(failure_kind kind)
+{
+  failures_[static_cast<size_t>(kind)]++;
+}
+
+void metrics::write(std::ostream& out) const
+{
+  out << "# HELP advice_stage_duration_seconds Time spent in each stage of making a post.\n";
+  out << "# TYPE advice_stage_duration_seconds histogram\n";
+
+  for (size_t i = 0; i < stageCount; i++)
+  {
+    const histogram& source = stages_[i];
+
+    // Prometheus buckets are cumulative.
+    uint64_t cumulative = 0;
+    for (size_t bucket = 0; bucket < bucketCount; bucket++)
+    {
+      cumulative += source.buckets[bucket];
+
+      out << "advice_stage_duration_seconds_bucket{stage=\"" << stageNames[i]
+        << "\",le=\"" << bucketBounds[bucket] << "\"} " << cumulative << "\n";
+    }
+
+    cumulative += source.buckets[bucketCount];
+
+    out << "advice_stage_duration_seconds_bucket{stage=\"" << stageNames[i]
+      << "\",le=\"+Inf\"} " << cumulative << "\n";
+    out << "advice_stage_duration_seconds_sum{stage=\"" << stageNames[i]
+      << "\"} " << (source.microseconds / 1000000.0) << "\n";
+    // The count is the +Inf bucket, so the two always agree.
+    out << "advice_stage_duration_seconds_count{stage=\"" << stageNames[i]
+      << "\"} " << cumulative << "\n";
+  }
+
+  out << "# HELP advice_failures_total Failures while making posts, by class.\n";
+  out << "# TYPE advice_failures_total counter\n";
+
+  for (size_t i = 0; i < failureCount; i++)
+  {
+    out << "advice_failures_total{class=\"" << failureNames[i] << "\"} "
+      << failures_[i] << "\n";
+  }
+}
+
+metrics& globalMetrics()
+{
+  static metrics instance;
+
+  return instance;
+}
+
+metrics_exporter::metrics_exporter(
+  std::string path,
+  std::chrono::seconds interval) :
+    path_(std::move(path)),
+    interval_(interval > std::chrono::seconds::zero() ? interval : std::chrono::seconds(15)),
+    thread_(&metrics_exporter::run, this)
+{
+}
+
+metrics_exporter::~metrics_exporter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+
+  wake_.notify_all();
+  thread_.join();
+
+  // Leave the final numbers behind.
+  writeFile();
+}
+
+void metrics_exporter::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!wake_.wait_for(lock, interval_, [this] () {
+    return stopping_;
+  }))
+  {
+    writeFile();
+  }
+}
+
+void metrics_exporter::writeFile() const
+{
+  std::string tempPath = path_ + ".tmp";
+
+  {
+    std::ofstream file(tempPath, std::ios::trunc);
+    globalMetrics().write(file);
+
+    if (!file)
+    {
+      LOG(warning) << "Could not write metrics to " << tempPath;
+      std::remove(tempPath.c_str());
+
+      return;
+    }
+  }
+
+  std::rename(tempPath.c_str(), path_.c_str());
+}
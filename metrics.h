@@ -0,0 +1,128 @@
+#ifndef METRICS_H_F2A8C61D
+#define METRICS_H_F2A8C61D
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+enum class stage {
+  noun_query,
+  url_list_fetch,
+  image_fetch,
+  decode,
+  generate,
+  layout,
+  draw,
+  encode,
+  upload,
+  post
+};
+
+enum class failure_kind {
+  could_not_get_images,
+  image_error,
+  twitter_error
+};
+
+/**
+ * Counters and latency histograms for the stages of making a post, shared by
+ * every thread in the process. Recording a measurement only touches
+ * atomics.
+ */
+class metrics {
+public:
+
+  void observe(stage which, std::chrono::duration<double> elapsed);
+
+  void countFailure(failure_kind kind);
+
+  /**
+   * Writes everything in the Prometheus text exposition format.
+   */
+  void write(std::ostream& out) const;
+
+private:
+
+  static const size_t stageCount = static_cast<size_t>(stage::post) + 1;
+  static const size_t failureCount = static_cast<size_t>(failure_kind::twitter_error) + 1;
+  static const size_t bucketCount = 14;
+
+  struct histogram {
+    // The last bucket is +Inf.
+    std::array<std::atomic<uint64_t>, bucketCount + 1> buckets {};
+    std::atomic<uint64_t> microseconds {0};
+  };
+
+  std::array<histogram, stageCount> stages_;
+  std::array<std::atomic<uint64_t>, failureCount> failures_ {};
+};
+
+/**
+ * The metrics for the whole process.
+ */
+metrics& globalMetrics();
+
+/**
+ * Records how long a scope took as a stage of making a post.
+ */
+class stage_timer {
+public:
+
+  explicit stage_timer(stage which) :
+    which_(which),
+    start_(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~stage_timer()
+  {
+    globalMetrics().observe(which_, std::chrono::steady_clock::now() - start_);
+  }
+
+  stage_timer(const stage_timer& other) = delete;
+  stage_timer& operator=(const stage_timer& other) = delete;
+
+private:
+
+  stage which_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Periodically writes the global metrics to a file for the node exporter's
+ * textfile collector to pick up. The file is replaced atomically, so it is
+ * never read half written.
+ */
+class metrics_exporter {
+public:
+
+  metrics_exporter(std::string path, std::chrono::seconds interval);
+
+  ~metrics_exporter();
+
+  metrics_exporter(const metrics_exporter& other) = delete;
+  metrics_exporter& operator=(const metrics_exporter& other) = delete;
+
+private:
+
+  void run();
+
+  void writeFile() const;
+
+  std::string path_;
+  std::chrono::seconds interval_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+
+  std::thread thread_;
+};
+
+#endif /* end of include guard: METRICS_H_F2A8C61D */
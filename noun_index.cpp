@@ -0,0 +1,159 @@
+#include "noun_index.h"
+#include "selrestrs.h"
+#include "trace.h"
+#include "logger.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+noun_index::noun_index(
+  const verbly::database& database,
+  const verbly::filter& badWords)
+{
+  verbly::filter condition =
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::noun)
+    && (verbly::form::proper == false)
+    //&& (verbly::form::complexity == 1)
+    && (verbly::word::tagCount >= 1)
+    && badWords;
+
+  for (const verbly::word& word : database.words(condition, {}, -1).all())
+  {
+    all_.push_back(word.getId());
+  }
+
+  if (all_.empty())
+  {
+    throw std::runtime_error("No eligible nouns in database");
+  }
+
+  std::sort(std::begin(all_), std::end(all_));
+  all_.erase(std::unique(std::begin(all_), std::end(all_)), std::end(all_));
+
+  for (int wnid : mappedWnids())
+  {
+    hyponyms_[wnid] = hyponyms(database, condition, wnid);
+  }
+}
+
+int noun_index::choose(
+  std::string role,
+  const std::set<std::string>& selrestrs,
+  std::mt19937& rng) const
+{
+  const std::vector<int>* candidates = selection(selrestrs);
+
+  if (candidates == nullptr)
+  {
+    const selrestr_mapping* mapping = findRole(role);
+    if (mapping != nullptr)
+    {
+      candidates = &hyponyms_.at(mapping->wnids[0]);
+    } else {
+      candidates = &all_;
+    }
+  }
+
+  if (candidates->empty())
+  {
+    LOG(debug) << "Selection failed";
+
+    candidates = &all_;
+  }
+
+  std::uniform_int_distribution<size_t> dist(0, candidates->size() - 1);
+
+  return (*candidates)[dist(rng)];
+}
+
+std::vector<int> noun_index::hyponyms(
+  const verbly::database& database,
+  const verbly::filter& condition,
+  int wnid) const
+{
+  trace_span span("words", "verbly");
+
+  if (span.active())
+  {
+    span.annotate("filter", "eligible hyponyms of notion " + std::to_string(wnid));
+  }
+
+  std::vector<int> result;
+
+  for (const verbly::word& word : database.words(
+    condition && (verbly::notion::fullHypernyms %= (verbly::notion::wnid == wnid)),
+    {},
+    -1).all())
+  {
+    result.push_back(word.getId());
+  }
+
+  std::sort(std::begin(result), std::end(result));
+  result.erase(std::unique(std::begin(result), std::end(result)), std::end(result));
+
+  return result;
+}
+
+const std::vector<int>* noun_index::selection(
+  const std::set<std::string>& selrestrs) const
+{
+  std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+
+  auto cached = selections_.find(selrestrs);
+  if (cached != std::end(selections_))
+  {
+    return cached->second;
+  }
+
+  std::set<int> wnids;
+  for (const std::string& selrestr : selrestrs)
+  {
+    const selrestr_mapping* mapping = findSelrestr(selrestr);
+    if (mapping != nullptr)
+    {
+      for (int wnid : mapping->wnids)
+      {
+        if (wnid != 0)
+        {
+          wnids.insert(wnid);
+        }
+      }
+    }
+  }
+
+  const std::vector<int>* result = nullptr;
+
+  if (wnids.size() == 1)
+  {
+    result = &hyponyms_.at(*std::begin(wnids));
+  } else if (wnids.size() > 1)
+  {
+    auto merged = unions_.find(wnids);
+    if (merged == std::end(unions_))
+    {
+      // The arrays are sorted, so the union can be merged directly. Words
+      // that satisfy more than one restriction must only be counted once.
+      std::vector<int> candidates;
+      for (int wnid : wnids)
+      {
+        const std::vector<int>& source = hyponyms_.at(wnid);
+
+        std::vector<int> next;
+        std::set_union(
+          std::begin(candidates), std::end(candidates),
+          std::begin(source), std::end(source),
+          std::back_inserter(next));
+
+        candidates = std::move(next);
+      }
+
+      merged = unions_.emplace(wnids, std::move(candidates)).first;
+    }
+
+    result = &merged->second;
+  }
+
+  selections_[selrestrs] = result;
+
+  return result;
+}
@@ -0,0 +1,59 @@
+#ifndef NOUN_INDEX_H_3E0B7C25
+#define NOUN_INDEX_H_3E0B7C25
+
+#include <verbly.h>
+#include <random>
+#include <string>
+#include <set>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * An in-memory index of the nouns that sentence can use, built once at
+ * startup. Each selection restriction and role fallback maps to a sorted
+ * array of the IDs of eligible words that are hyponyms of it, so choosing a
+ * noun does not require a query.
+ */
+class noun_index {
+public:
+
+  noun_index(
+    const verbly::database& database,
+    const verbly::filter& badWords);
+
+  /**
+   * Chooses the ID of a random noun satisfying the selection restrictions,
+   * or the role if none of the restrictions are known. Falls back to any
+   * eligible noun if nothing satisfies them.
+   */
+  int choose(
+    std::string role,
+    const std::set<std::string>& selrestrs,
+    std::mt19937& rng) const;
+
+private:
+
+  std::vector<int> hyponyms(
+    const verbly::database& database,
+    const verbly::filter& condition,
+    int wnid) const;
+
+  /**
+   * Returns the candidates for a set of selection restrictions, merging and
+   * caching them the first time the set is seen. Returns nullptr if none of
+   * the restrictions are known.
+   */
+  const std::vector<int>* selection(
+    const std::set<std::string>& selrestrs) const;
+
+  std::vector<int> all_;
+  std::map<int, std::vector<int>> hyponyms_;
+
+  // Guards the caches, since the index can be shared between threads.
+  mutable std::mutex cacheMutex_;
+  mutable std::map<std::set<std::string>, const std::vector<int>*> selections_;
+  mutable std::map<std::set<int>, std::vector<int>> unions_;
+};
+
+#endif /* end of include guard: NOUN_INDEX_H_3E0B7C25 */
@@ -0,0 +1,172 @@
+#include "picture_finder.h"
+#include "renderer.h"
+#include "metrics.h"
+#include "trace.h"
+#include "logger.h"
+#include <algorithm>
+#include <vector>
+
+picture_finder::picture_finder(
+  const verbly::database& database,
+  const word_pool& pictures,
+  std::mt19937& rng,
+  const finder_config& config) :
+    database_(database),
+    pictures_(pictures),
+    rng_(rng),
+    fetcher_(new fetcher()),
+    cache_(config.cacheDirectory.empty()
+      ? nullptr
+      : new image_cache(config.cacheDirectory, config.cacheBytes)),
+    urlLists_(config.urlListDirectory.empty()
+      ? nullptr
+      : new url_list_cache(*fetcher_, config.urlListDirectory, config.urlListTtl)),
+    deadUrls_(config.deadUrlFile.empty()
+      ? nullptr
+      : new dead_url_cache(config.deadUrlFile, config.deadUrlTtl)),
+    prober_(*fetcher_, cache_.get(), deadUrls_.get(), config.concurrency)
+{
+}
+
+picture picture_finder::find() const
+{
+  trace_span span("find", "picture");
+
+  verbly::word pictured = chooseNoun();
+
+  LOG(info) << "Generating noun...";
+  LOG(info) << "Noun: " << pictured.getBaseForm().getText();
+  LOG(info) << "Getting URLs...";
+
+  std::shared_ptr<const url_list> lst;
+  {
+    stage_timer timer(stage::url_list_fetch);
+    lst = getUrlList(pictured);
+  }
+
+  std::vector<size_t> order;
+  order.reserve(lst->size());
+  for (size_t i = 0; i < lst->size(); i++)
+  {
+    if (!deadUrls_ || !deadUrls_->isDead(lst->data(i), lst->length(i)))
+    {
+      order.push_back(i);
+    }
+  }
+
+  if (order.size() < lst->size())
+  {
+    LOG(info) << "Skipping " << (lst->size() - order.size()) << " dead URLs.";
+  }
+
+  if (order.empty())
+  {
+    throw could_not_get_images();
+  }
+
+  std::shuffle(std::begin(order), std::end(order), rng_);
+
+  std::string foundUrl;
+  Magick::Image pic;
+  bool found = prober_.probe(
+    *lst,
+    order,
+    400,
+    Magick::Geometry(renderer::width, renderer::height),
+    foundUrl,
+    pic);
+
+  if (!found)
+  {
+    throw could_not_get_images();
+  }
+
+  picture result;
+  result.noun = pictured.getBaseForm().getText();
+  result.url = foundUrl;
+  result.image = pic;
+
+  if (span.active())
+  {
+    span.annotate("noun", result.noun);
+    span.annotate("url", result.url);
+  }
+
+  return result;
+}
+
+verbly::word picture_finder::chooseNoun() const
+{
+  stage_timer timer(stage::noun_query);
+  trace_span span("words", "verbly");
+
+  int wordId = pictures_.choose(rng_);
+
+  if (span.active())
+  {
+    span.annotate("filter", "word.id == " + std::to_string(wordId));
+  }
+
+  return database_.words(verbly::word::id == wordId).first();
+}
+
+std::shared_ptr<const url_list> picture_finder::getUrlList(
+  const verbly::word& pictured) const
+{
+  trace_span span("url_list", "picture");
+
+  int wnid = pictured.getNotion().getWnid();
+  std::string lsturl = pictured.getNotion().getImageNetUrl();
+
+  if (span.active())
+  {
+    span.annotate("url", lsturl);
+  }
+
+  if (urlLists_)
+  {
+    std::shared_ptr<const url_list> cached = urlLists_->get(wnid, lsturl);
+    if (cached)
+    {
+      LOG(info) << "Got URLs from cache.";
+
+      return cached;
+    }
+  }
+
+  std::shared_ptr<const url_list> result =
+    std::make_shared<const url_list>(url_list::parse(downloadUrlList(lsturl)));
+
+  if (urlLists_)
+  {
+    urlLists_->put(wnid, result);
+  }
+
+  return result;
+}
+
+std::string picture_finder::downloadUrlList(const std::string& lsturl) const
+{
+  trace_span span("url_list_download", "picture");
+
+  // Failures are retried by the prefetcher, which backs off between them.
+  fetch_result lst;
+  try
+  {
+    lst = fetcher_->get(lsturl);
+  } catch (const fetch_error& e)
+  {
+    LOG(warning) << lsturl << ": " << e.what();
+
+    throw could_not_get_images();
+  }
+
+  if ((lst.responseCode != 200) || lst.body.empty())
+  {
+    throw could_not_get_images();
+  }
+
+  LOG(info) << "Got URLs (" << lst.timing << ").";
+
+  return std::move(lst.body);
+}
@@ -0,0 +1,95 @@
+#ifndef PICTURE_FINDER_H_2C94E7B3
+#define PICTURE_FINDER_H_2C94E7B3
+
+#include <verbly.h>
+#include <Magick++.h>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <stdexcept>
+#include <memory>
+#include "word_pool.h"
+#include "image_prober.h"
+#include "fetcher.h"
+#include "image_cache.h"
+#include "url_list_cache.h"
+#include "dead_url_cache.h"
+
+class could_not_get_images : public std::runtime_error {
+public:
+
+  could_not_get_images() : std::runtime_error("Could not get images for noun")
+  {
+  }
+};
+
+/**
+ * A downloaded picture of a noun that is big enough to use.
+ */
+struct picture {
+  std::string noun;
+  std::string url;
+  Magick::Image image;
+};
+
+/**
+ * Settings for how pictures are fetched, read from the config file.
+ */
+struct finder_config {
+  // The number of candidate images to download at once.
+  size_t concurrency = 1;
+
+  // Where to keep images that have already been downloaded; the cache is
+  // disabled if this is empty.
+  std::string cacheDirectory;
+  uint64_t cacheBytes = 256 * 1024 * 1024;
+
+  // Where to keep the URL lists of notions; lists are always downloaded if
+  // this is empty.
+  std::string urlListDirectory;
+  std::chrono::seconds urlListTtl = std::chrono::hours(24 * 7);
+
+  // Where to record image URLs that failed; failures are forgotten if this
+  // is empty.
+  std::string deadUrlFile;
+  std::chrono::seconds deadUrlTtl = std::chrono::hours(24 * 30);
+};
+
+/**
+ * Chooses a noun that can be pictured and hunts for a usable picture of it
+ * among its ImageNet URLs.
+ */
+class picture_finder {
+public:
+
+  picture_finder(
+    const verbly::database& database,
+    const word_pool& pictures,
+    std::mt19937& rng,
+    const finder_config& config);
+
+  /**
+   * Throws could_not_get_images if none of the noun's pictures can be used.
+   */
+  picture find() const;
+
+private:
+
+  verbly::word chooseNoun() const;
+
+  std::shared_ptr<const url_list> getUrlList(const verbly::word& pictured) const;
+
+  std::string downloadUrlList(const std::string& lsturl) const;
+
+  const verbly::database& database_;
+  const word_pool& pictures_;
+  std::mt19937& rng_;
+  std::unique_ptr<fetcher> fetcher_;
+  std::unique_ptr<image_cache> cache_;
+  std::unique_ptr<url_list_cache> urlLists_;
+  std::unique_ptr<dead_url_cache> deadUrls_;
+  image_prober prober_;
+};
+
+#endif /* end of include guard: PICTURE_FINDER_H_2C94E7B3 */
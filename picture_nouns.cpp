@@ -0,0 +1,234 @@
+#include "picture_nouns.h"
+#include "fnv.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+
+  const std::vector<int> defaultWhitelist = {
+    109287968, // Geological formations
+    109208496, // Asterisms (collections of stars)
+    109239740, // Celestial bodies
+    109277686, // Exterrestrial objects (comets and meteroids)
+    109403211, // Radiators (supposedly natural radiators but actually these are just pictures of radiators)
+    109416076, // Rocks
+    105442131, // Chromosomes
+    100324978, // Tightrope walking
+    100326094, // Rock climbing
+    100433458, // Contact sports
+    100433802, // Gymnastics
+    100439826, // Track and field
+    100440747, // Skiing
+    100441824, // Water sport
+    100445351, // Rowing
+    100446980, // Archery
+      // TODO: add more sports
+    100021939, // Artifacts
+    101471682 // Vertebrates
+  };
+
+  const std::vector<int> defaultBlacklist = {
+    106883725, // swastika
+    104416901, // tetraskele
+    102512053, // fish
+    103575691, // instrument of execution
+    103829563 // noose
+  };
+
+  const char cacheMagic[4] = {'A', 'D', 'V', 'P'};
+  const uint32_t cacheVersion = 1;
+
+  verbly::filter anyOf(const std::vector<int>& wnids)
+  {
+    verbly::filter result = (verbly::notion::wnid == wnids.front());
+    for (auto it = std::next(std::begin(wnids)); it != std::end(wnids); it++)
+    {
+      result = result || (verbly::notion::wnid == *it);
+    }
+
+    return result;
+  }
+
+  // Identifies what the pool was built from: the lists, and the database
+  // file's size and modification time.
+  uint64_t cacheKey(const std::string& datafile, const picture_lists& lists)
+  {
+    std::vector<int64_t> key;
+    key.push_back(lists.whitelist.size());
+    key.insert(std::end(key), std::begin(lists.whitelist), std::end(lists.whitelist));
+    key.push_back(lists.blacklist.size());
+    key.insert(std::end(key), std::begin(lists.blacklist), std::end(lists.blacklist));
+
+    struct stat info;
+    if (stat(datafile.c_str(), &info) == 0)
+    {
+      key.push_back(info.st_size);
+      key.push_back(info.st_mtime);
+    }
+
+    return fnv1a64(key.data(), key.size() * sizeof(int64_t));
+  }
+
+  bool readCache(
+    const std::string& cacheFile,
+    uint64_t key,
+    std::vector<std::pair<int, int>>& words)
+  {
+    std::ifstream file(cacheFile, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+      return false;
+    }
+
+    uint64_t fileSize = file.tellg();
+    file.seekg(0);
+
+    char magic[sizeof(cacheMagic)];
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    uint64_t count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    if (!file
+      || !std::equal(std::begin(magic), std::end(magic), std::begin(cacheMagic))
+      || (version != cacheVersion)
+      || (storedKey != key))
+    {
+      return false;
+    }
+
+    // A damaged count must not be trusted with an allocation.
+    uint64_t headerSize = sizeof(magic) + sizeof(version) + sizeof(storedKey) + sizeof(count);
+    uint64_t rowSize = 2 * sizeof(int32_t);
+    if ((headerSize > fileSize)
+      || ((fileSize - headerSize) % rowSize != 0)
+      || (count != (fileSize - headerSize) / rowSize))
+    {
+      return false;
+    }
+
+    std::vector<int32_t> stored(count * 2);
+    file.read(reinterpret_cast<char*>(stored.data()), stored.size() * sizeof(int32_t));
+    if (!file)
+    {
+      return false;
+    }
+
+    words.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+      words.emplace_back(stored[i * 2], stored[i * 2 + 1]);
+    }
+
+    return true;
+  }
+
+  void writeCache(
+    const std::string& cacheFile,
+    uint64_t key,
+    const std::vector<std::pair<int, int>>& words)
+  {
+    std::vector<int32_t> stored;
+    for (const std::pair<int, int>& word : words)
+    {
+      stored.push_back(word.first);
+      stored.push_back(word.second);
+    }
+
+    uint64_t count = words.size();
+    std::string tempPath = cacheFile + ".tmp";
+
+    {
+      std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+      file.write(cacheMagic, sizeof(cacheMagic));
+      file.write(reinterpret_cast<const char*>(&cacheVersion), sizeof(cacheVersion));
+      file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+      file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      file.write(reinterpret_cast<const char*>(stored.data()), stored.size() * sizeof(int32_t));
+
+      if (!file)
+      {
+        std::remove(tempPath.c_str());
+
+        return;
+      }
+    }
+
+    std::rename(tempPath.c_str(), cacheFile.c_str());
+  }
+
+}
+
+picture_lists picture_lists::read(const YAML::Node& config)
+{
+  picture_lists result;
+  result.whitelist = defaultWhitelist;
+  result.blacklist = defaultBlacklist;
+
+  if (config["picture_whitelist"])
+  {
+    result.whitelist = config["picture_whitelist"].as<std::vector<int>>();
+  }
+
+  if (config["picture_blacklist"])
+  {
+    result.blacklist = config["picture_blacklist"].as<std::vector<int>>();
+  }
+
+  if (result.whitelist.empty())
+  {
+    throw std::invalid_argument("picture_whitelist must not be empty");
+  }
+
+  return result;
+}
+
+verbly::filter picture_lists::condition() const
+{
+  verbly::filter result =
+    (verbly::notion::fullHypernyms %= anyOf(whitelist))
+    && (verbly::notion::partOfSpeech == verbly::part_of_speech::noun)
+    && (verbly::notion::numOfImages >= 1);
+
+  if (!blacklist.empty())
+  {
+    result = result && !(verbly::notion::fullHypernyms %= anyOf(blacklist));
+  }
+
+  return result;
+}
+
+std::unique_ptr<word_pool> loadPictureNouns(
+  const verbly::database& database,
+  const std::string& datafile,
+  const picture_lists& lists,
+  const std::string& cacheFile)
+{
+  if (cacheFile.empty())
+  {
+    return std::unique_ptr<word_pool>(new word_pool(database, lists.condition()));
+  }
+
+  uint64_t key = cacheKey(datafile, lists);
+
+  std::vector<std::pair<int, int>> words;
+  if (readCache(cacheFile, key, words))
+  {
+    LOG(info) << "Loaded " << words.size() << " picture nouns from cache";
+
+    return std::unique_ptr<word_pool>(new word_pool(std::move(words)));
+  }
+
+  std::unique_ptr<word_pool> result(new word_pool(database, lists.condition()));
+  writeCache(cacheFile, key, result->entries());
+
+  return result;
+}
@@ -0,0 +1,42 @@
+#ifndef PICTURE_NOUNS_H_3B9F04C6
+#define PICTURE_NOUNS_H_3B9F04C6
+
+#include <verbly.h>
+#include <yaml-cpp/yaml.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "word_pool.h"
+
+/**
+ * The notions whose hyponyms the bot looks for pictures of, and the notions
+ * whose hyponyms it avoids even so.
+ */
+struct picture_lists {
+  std::vector<int> whitelist;
+  std::vector<int> blacklist;
+
+  /**
+   * Reads the picture_whitelist and picture_blacklist keys, using the
+   * built-in lists for any that are missing.
+   */
+  static picture_lists read(const YAML::Node& config);
+
+  /**
+   * Matches the nouns that the bot looks for pictures of.
+   */
+  verbly::filter condition() const;
+};
+
+/**
+ * Loads the nouns that can be pictured. If cacheFile is not empty, the pool
+ * is read from it when it was built from the same lists and database, and is
+ * otherwise queried and written to it.
+ */
+std::unique_ptr<word_pool> loadPictureNouns(
+  const verbly::database& database,
+  const std::string& datafile,
+  const picture_lists& lists,
+  const std::string& cacheFile);
+
+#endif /* end of include guard: PICTURE_NOUNS_H_3B9F04C6 */
@@ -0,0 +1,369 @@
+#include "poster.h"
+#include "metrics.h"
+#include "trace.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+
+  const std::string postExtension = ".post";
+  const std::string tempExtension = ".tmp";
+
+  bool endsWith(const std::string& name, const std::string& suffix)
+  {
+    return (name.length() > suffix.length())
+      && (name.compare(name.length() - suffix.length(), suffix.length(), suffix) == 0);
+  }
+
+  // A post that has failed keeps its attempt count in its file name, as in
+  // 000001700000000-000001.2.post, so that the count survives a restart.
+  // Splits a name into the part before the count and the count.
+  std::string splitAttempts(const std::string& name, int& attempts)
+  {
+    std::string stem = name.substr(0, name.length() - postExtension.length());
+    attempts = 0;
+
+    size_t dot = stem.rfind('.');
+    if ((dot != std::string::npos)
+      && (dot + 1 < stem.length())
+      && (stem.length() - dot - 1 <= 9)
+      && (stem.find_first_not_of("0123456789", dot + 1) == std::string::npos))
+    {
+      attempts = std::stoi(stem.substr(dot + 1));
+      stem.erase(dot);
+    }
+
+    return stem;
+  }
+
+}
+
+poster::poster(
+  const twitter::client& client,
+  scheduler& schedule,
+  std::string directory,
+  size_t depth,
+  int maxAttempts) :
+    client_(client),
+    scheduler_(schedule),
+    directory_(std::move(directory)),
+    depth_(depth > 0 ? depth : 1),
+    maxAttempts_(maxAttempts > 0 ? maxAttempts : 1)
+{
+  if (!directory_.empty())
+  {
+    for (std::string path : {directory_, directory_ + "/failed"})
+    {
+      if ((mkdir(path.c_str(), 0755) != 0) && (errno != EEXIST))
+      {
+        throw std::runtime_error("Could not create outbox " + path);
+      }
+    }
+
+    load();
+  }
+
+  thread_ = std::thread(&poster::publish, this);
+}
+
+poster::~poster()
+{
+  {
+    std::lock_guard<std::mutex> queueLock(mutex_);
+    stopping_ = true;
+  }
+
+  notEmpty_.notify_all();
+
+  // This can wait for an upload in progress to finish or time out.
+  thread_.join();
+}
+
+void poster::submit(std::string title, const encoded_image& image)
+{
+  std::shared_ptr<post> next = std::make_shared<post>();
+  next->title = std::move(title);
+  next->mimeType = image.mimeType;
+  next->image.assign(
+    static_cast<const char*>(image.data.data()),
+    image.data.length());
+
+  save(*next);
+
+  std::unique_lock<std::mutex> queueLock(mutex_);
+  notFull_.wait(queueLock, [this] () {
+    return (queue_.size() < depth_) || failure_;
+  });
+
+  if (failure_)
+  {
+    std::rethrow_exception(failure_);
+  }
+
+  queue_.push_back(std::move(next));
+
+  queueLock.unlock();
+  notEmpty_.notify_one();
+}
+
+void poster::publish()
+{
+  try
+  {
+    std::unique_lock<std::mutex> queueLock(mutex_);
+
+    for (;;)
+    {
+      notEmpty_.wait(queueLock, [this] () {
+        return stopping_ || !queue_.empty();
+      });
+
+      if (stopping_)
+      {
+        return;
+      }
+
+      // Wait for the post's slot, unless the bot is stopping.
+      if (notEmpty_.wait_until(queueLock, scheduler_.nextSlot(), [this] () {
+        return stopping_;
+      }))
+      {
+        return;
+      }
+
+      std::shared_ptr<post> next = queue_.front();
+
+      queueLock.unlock();
+      bool published = publishOne(*next);
+      queueLock.lock();
+
+      if (published)
+      {
+        if (!next->path.empty())
+        {
+          std::remove(next->path.c_str());
+        }
+      } else if (recordAttempt(*next) >= maxAttempts_)
+      {
+        // Keep the post for a person to look at, and move on.
+        LOG(error) << "Giving up on post: How to " << next->title;
+
+        moveToFailed(*next);
+      } else {
+        std::chrono::seconds wait = scheduler_.failed(failure_class::twitter);
+
+        if (notEmpty_.wait_for(queueLock, wait, [this] () {
+          return stopping_;
+        }))
+        {
+          return;
+        }
+
+        continue;
+      }
+
+      queue_.pop_front();
+      notFull_.notify_one();
+    }
+  } catch (...)
+  {
+    {
+      std::lock_guard<std::mutex> queueLock(mutex_);
+      failure_ = std::current_exception();
+    }
+
+    notFull_.notify_all();
+  }
+}
+
+bool poster::publishOne(const post& next)
+{
+  trace_span span("publish", "post");
+
+  if (span.active())
+  {
+    span.annotate("title", next.title);
+    span.annotate("attempt", std::to_string(next.attempts + 1));
+  }
+
+  LOG(info) << "Tweeting...";
+
+  try
+  {
+    std::string tweetText = "How to " + next.title;
+    size_t tweetLim = 140 - client_.getConfiguration().getCharactersReservedPerMedia();
+    if (tweetText.length() > tweetLim)
+    {
+      tweetText = tweetText.substr(0, tweetLim - 1) + "…";
+    }
+
+    long media_id;
+    {
+      stage_timer timer(stage::upload);
+      trace_span uploadSpan("upload", "post");
+      media_id = client_.uploadMedia(next.mimeType, next.image.data(), next.image.length());
+    }
+
+    {
+      stage_timer timer(stage::post);
+      trace_span postSpan("update_status", "post");
+      client_.updateStatus(tweetText, {media_id});
+    }
+  } catch (const twitter::twitter_error& ex)
+  {
+    LOG(warning) << "Twitter error: " << ex.what();
+
+    globalMetrics().countFailure(failure_kind::twitter_error);
+
+    return false;
+  }
+
+  LOG(info) << "Tweeted!";
+
+  scheduler_.posted();
+
+  return true;
+}
+
+void poster::save(post& next)
+{
+  if (directory_.empty())
+  {
+    return;
+  }
+
+  // Names sort in the order the posts were made.
+  std::chrono::milliseconds now = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch());
+
+  std::ostringstream name;
+  name << directory_ << "/" << std::setw(15) << std::setfill('0') << now.count()
+    << "-" << std::setw(6) << (sequence_++ % 1000000) << postExtension;
+
+  std::string tempPath = name.str() + tempExtension;
+
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file << next.mimeType << '\n' << next.title << '\n';
+    file.write(next.image.data(), next.image.length());
+
+    if (!file)
+    {
+      // The post can still be published, it just will not survive a
+      // restart.
+      LOG(error) << "Could not save post to outbox";
+      std::remove(tempPath.c_str());
+
+      return;
+    }
+  }
+
+  std::rename(tempPath.c_str(), name.str().c_str());
+  next.path = name.str();
+}
+
+void poster::load()
+{
+  DIR* dir = opendir(directory_.c_str());
+  if (dir == nullptr)
+  {
+    return;
+  }
+
+  std::vector<std::string> names;
+  while (dirent* entry = readdir(dir))
+  {
+    std::string name(entry->d_name);
+    if (endsWith(name, postExtension))
+    {
+      names.push_back(std::move(name));
+    } else if (endsWith(name, postExtension + tempExtension))
+    {
+      // Left behind by a crash while the post was being saved.
+      std::remove((directory_ + "/" + name).c_str());
+    }
+  }
+
+  closedir(dir);
+
+  std::sort(std::begin(names), std::end(names));
+
+  for (const std::string& name : names)
+  {
+    std::shared_ptr<post> stored = std::make_shared<post>();
+    stored->path = directory_ + "/" + name;
+    splitAttempts(name, stored->attempts);
+
+    if (stored->attempts >= maxAttempts_)
+    {
+      moveToFailed(*stored);
+
+      continue;
+    }
+
+    std::ifstream file(stored->path, std::ios::binary);
+    std::getline(file, stored->mimeType);
+    std::getline(file, stored->title);
+    stored->image.assign(
+      (std::istreambuf_iterator<char>(file)),
+      std::istreambuf_iterator<char>());
+
+    if (stored->mimeType.empty() || stored->image.empty())
+    {
+      continue;
+    }
+
+    queue_.push_back(std::move(stored));
+  }
+
+  if (!queue_.empty())
+  {
+    LOG(info) << "Found " << queue_.size() << " posts in the outbox";
+  }
+}
+
+int poster::recordAttempt(post& next)
+{
+  next.attempts++;
+
+  if (!next.path.empty())
+  {
+    size_t slash = next.path.rfind('/');
+
+    int previous;
+    std::string stem = splitAttempts(next.path.substr(slash + 1), previous);
+    std::string renamed = next.path.substr(0, slash + 1) + stem + "."
+      + std::to_string(next.attempts) + postExtension;
+
+    if (std::rename(next.path.c_str(), renamed.c_str()) == 0)
+    {
+      next.path = renamed;
+    }
+  }
+
+  return next.attempts;
+}
+
+void poster::moveToFailed(const post& next) const
+{
+  if (next.path.empty())
+  {
+    return;
+  }
+
+  std::string failedPath = directory_ + "/failed/"
+    + next.path.substr(next.path.rfind('/') + 1);
+
+  std::rename(next.path.c_str(), failedPath.c_str());
+}
@@ -0,0 +1,111 @@
+#ifndef POSTER_H_A4D17E3B
+#define POSTER_H_A4D17E3B
+
+#include <twitter.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "encoder.h"
+#include "scheduler.h"
+
+/**
+ * A rendered post waiting to be published.
+ */
+struct post {
+  std::string title;
+  std::string mimeType;
+  std::string image;
+
+  // The file that holds the post in the outbox, if there is one. Its name
+  // includes the number of failed attempts.
+  std::string path;
+  int attempts = 0;
+};
+
+/**
+ * Publishes rendered posts on a background thread, each at its scheduled
+ * slot, so that the next post can be rendered while one is uploading. Posts
+ * wait in an outbox directory until they have been published, which means
+ * that they survive restarts, and a post that fails is retried rather than
+ * being rendered again.
+ */
+class poster {
+public:
+
+  /**
+   * Posts already in the outbox directory are published first. If the
+   * directory is empty, the outbox is kept in memory only. A post that fails
+   * maxAttempts times is moved to the failed directory inside the outbox.
+   */
+  poster(
+    const twitter::client& client,
+    scheduler& schedule,
+    std::string directory,
+    size_t depth,
+    int maxAttempts);
+
+  ~poster();
+
+  poster(const poster& other) = delete;
+  poster& operator=(const poster& other) = delete;
+
+  /**
+   * Adds a post to the outbox, waiting while it already holds depth posts.
+   * Rethrows any unexpected error that stopped the background thread.
+   */
+  void submit(std::string title, const encoded_image& image);
+
+private:
+
+  void publish();
+
+  /**
+   * Uploads the post. Returns false if Twitter rejected it.
+   */
+  bool publishOne(const post& next);
+
+  /**
+   * Writes a post to the outbox directory. Only the thread that submits
+   * posts calls this.
+   */
+  void save(post& next);
+
+  /**
+   * Loads the posts in the outbox directory, and removes any that were only
+   * partly saved.
+   */
+  void load();
+
+  /**
+   * Counts a failed attempt to publish the post, recording it in the post's
+   * file name so that it survives a restart. Returns the new count.
+   */
+  int recordAttempt(post& next);
+
+  /**
+   * Moves the post's file to the failed directory for a person to look at.
+   */
+  void moveToFailed(const post& next) const;
+
+  const twitter::client& client_;
+  scheduler& scheduler_;
+  std::string directory_;
+  size_t depth_;
+  int maxAttempts_;
+  unsigned long sequence_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable notEmpty_;
+  std::condition_variable notFull_;
+  std::deque<std::shared_ptr<post>> queue_;
+  bool stopping_ = false;
+  std::exception_ptr failure_;
+
+  std::thread thread_;
+};
+
+#endif /* end of include guard: POSTER_H_A4D17E3B */
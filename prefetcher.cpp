@@ -0,0 +1,154 @@
+#include "prefetcher.h"
+#include "metrics.h"
+#include "logger.h"
+
+prefetcher::prefetcher(
+  std::string datafile,
+  const word_pool& pictures,
+  const renderer& render,
+  scheduler& schedule,
+  finder_config config,
+  size_t depth,
+  size_t memoryCap,
+  std::mt19937::result_type seed) :
+    datafile_(std::move(datafile)),
+    pictures_(pictures),
+    renderer_(render),
+    scheduler_(schedule),
+    config_(std::move(config)),
+    depth_(depth > 0 ? depth : 1),
+    memoryCap_(memoryCap),
+    rng_(seed),
+    thread_(&prefetcher::produce, this)
+{
+}
+
+prefetcher::~prefetcher()
+{
+  {
+    std::lock_guard<std::mutex> queueLock(mutex_);
+    stopping_ = true;
+  }
+
+  notFull_.notify_all();
+
+  // This can wait for the download in progress to finish or time out.
+  thread_.join();
+}
+
+picture prefetcher::pop()
+{
+  std::unique_lock<std::mutex> queueLock(mutex_);
+  notEmpty_.wait(queueLock, [this] () {
+    return !queue_.empty() || failure_;
+  });
+
+  if (queue_.empty())
+  {
+    std::rethrow_exception(failure_);
+  }
+
+  picture result = std::move(queue_.front());
+  queue_.pop_front();
+  queueBytes_ -= pixelBytes(result);
+
+  queueLock.unlock();
+  notFull_.notify_one();
+
+  return result;
+}
+
+void prefetcher::produce()
+{
+  try
+  {
+    verbly::database database(datafile_);
+    picture_finder finder(database, pictures_, rng_, config_);
+
+    while (produceOne(finder))
+    {
+    }
+  } catch (...)
+  {
+    {
+      std::lock_guard<std::mutex> queueLock(mutex_);
+      failure_ = std::current_exception();
+    }
+
+    notEmpty_.notify_all();
+  }
+}
+
+bool prefetcher::produceOne(const picture_finder& finder)
+{
+  {
+    std::lock_guard<std::mutex> queueLock(mutex_);
+    if (stopping_)
+    {
+      return false;
+    }
+  }
+
+  picture next;
+
+  try
+  {
+    next = finder.find();
+    renderer_.cropAndZoom(next.image);
+  } catch (const could_not_get_images& ex)
+  {
+    LOG(warning) << ex.what();
+
+    globalMetrics().countFailure(failure_kind::could_not_get_images);
+
+    return backOff(failure_class::fetch);
+  } catch (const Magick::Exception& ex)
+  {
+    LOG(warning) << "Image error: " << ex.what();
+
+    globalMetrics().countFailure(failure_kind::image_error);
+
+    return backOff(failure_class::image);
+  }
+
+  scheduler_.succeeded(failure_class::fetch);
+
+  size_t bytes = pixelBytes(next);
+
+  std::unique_lock<std::mutex> queueLock(mutex_);
+  notFull_.wait(queueLock, [&] () {
+    return stopping_
+      || queue_.empty()
+      || ((queue_.size() < depth_) && (queueBytes_ + bytes <= memoryCap_));
+  });
+
+  if (stopping_)
+  {
+    return false;
+  }
+
+  queue_.push_back(std::move(next));
+  queueBytes_ += bytes;
+
+  queueLock.unlock();
+  notEmpty_.notify_one();
+
+  return true;
+}
+
+bool prefetcher::backOff(failure_class reason)
+{
+  std::chrono::seconds wait = scheduler_.failed(reason);
+
+  std::unique_lock<std::mutex> queueLock(mutex_);
+  return !notFull_.wait_for(queueLock, wait, [this] () {
+    return stopping_;
+  });
+}
+
+size_t prefetcher::pixelBytes(const picture& pic)
+{
+  return static_cast<size_t>(pic.image.columns())
+    * pic.image.rows()
+    * sizeof(Magick::PixelPacket);
+}
@@ -0,0 +1,92 @@
+#ifndef PREFETCHER_H_E5A0D6F8
+#define PREFETCHER_H_E5A0D6F8
+
+#include <verbly.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include "picture_finder.h"
+#include "renderer.h"
+#include "scheduler.h"
+#include "word_pool.h"
+
+/**
+ * Hunts for pictures on a background thread and keeps a bounded queue of
+ * them, already decoded and cropped, so that posting never has to wait on
+ * the network. The thread has its own database connection and random
+ * engine, and backs off through the scheduler when no pictures can be
+ * fetched.
+ */
+class prefetcher {
+public:
+
+  /**
+   * The queue holds at most depth pictures, and at most memoryCap bytes of
+   * decoded pixels unless a single picture is larger than that.
+   */
+  prefetcher(
+    std::string datafile,
+    const word_pool& pictures,
+    const renderer& render,
+    scheduler& schedule,
+    finder_config config,
+    size_t depth,
+    size_t memoryCap,
+    std::mt19937::result_type seed);
+
+  ~prefetcher();
+
+  prefetcher(const prefetcher& other) = delete;
+  prefetcher& operator=(const prefetcher& other) = delete;
+
+  /**
+   * Removes the oldest picture from the queue, waiting for one if it is
+   * empty. Rethrows any unexpected error that stopped the background thread.
+   */
+  picture pop();
+
+private:
+
+  void produce();
+
+  /**
+   * Finds one picture and waits for room to queue it. Returns false once
+   * the prefetcher is stopping.
+   */
+  bool produceOne(const picture_finder& finder);
+
+  /**
+   * Waits before the next attempt after a failure, so that a run of them
+   * does not hammer the network. Returns false if the prefetcher started
+   * stopping in the meantime.
+   */
+  bool backOff(failure_class reason);
+
+  static size_t pixelBytes(const picture& pic);
+
+  std::string datafile_;
+  const word_pool& pictures_;
+  const renderer& renderer_;
+  scheduler& scheduler_;
+  finder_config config_;
+  size_t depth_;
+  size_t memoryCap_;
+  std::mt19937 rng_;
+
+  std::mutex mutex_;
+  std::condition_variable notEmpty_;
+  std::condition_variable notFull_;
+  std::deque<picture> queue_;
+  size_t queueBytes_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr failure_;
+
+  std::thread thread_;
+};
+
+#endif /* end of include guard: PREFETCHER_H_E5A0D6F8 */
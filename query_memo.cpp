@@ -0,0 +1,125 @@
+#include "query_memo.h"
+#include "vocabulary.h"
+#include "trace.h"
+#include <stdexcept>
+
+double query_stats::hitRate() const
+{
+  unsigned long lookups = hits + misses;
+
+  return (lookups == 0) ? 0.0 : static_cast<double>(hits) / lookups;
+}
+
+std::chrono::duration<double> query_stats::savedPerTitle() const
+{
+  if ((misses == 0) || (titles == 0))
+  {
+    return std::chrono::duration<double>::zero();
+  }
+
+  return missTime / static_cast<double>(misses) * static_cast<double>(hits) / static_cast<double>(titles);
+}
+
+query_stats& query_stats::operator+=(const query_stats& other)
+{
+  hits += other.hits;
+  misses += other.misses;
+  titles += other.titles;
+  missTime += other.missTime;
+
+  return *this;
+}
+
+std::ostream& operator<<(std::ostream& out, const query_stats& stats)
+{
+  return out << static_cast<int>(stats.hitRate() * 100) << "% of "
+    << (stats.hits + stats.misses) << " queries memoized, saving about "
+    << (stats.savedPerTitle().count() * 1000) << "ms per title";
+}
+
+query_memo::query_memo(const verbly::database& database) :
+  database_(database)
+{
+}
+
+const std::vector<verbly::frame>& query_memo::frames(
+  const verbly::word& verb,
+  bool experiencer)
+{
+  std::pair<int, bool> key(verb.getId(), experiencer);
+
+  auto cached = frames_.find(key);
+  if (cached != std::end(frames_))
+  {
+    stats_.hits++;
+  } else {
+    stats_.misses++;
+
+    trace_span span("frames", "verbly");
+
+    if (span.active())
+    {
+      span.annotate("filter", std::string(experiencer ? "experiencer " : "")
+        + "frames of verb " + std::to_string(verb.getId()));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    cached = frames_.emplace(
+      key,
+      database_.frames(vocabulary::frameCondition(experiencer) && verb, {}, -1).all()).first;
+
+    stats_.missTime += std::chrono::steady_clock::now() - start;
+  }
+
+  if (cached->second.empty())
+  {
+    throw std::out_of_range("Verb has no frames");
+  }
+
+  return cached->second;
+}
+
+const std::vector<verbly::word>& query_memo::prepositions(
+  const std::vector<std::string>& groups)
+{
+  auto cached = prepositions_.find(groups);
+  if (cached != std::end(prepositions_))
+  {
+    stats_.hits++;
+  } else {
+    stats_.misses++;
+
+    trace_span span("words", "verbly");
+
+    if (span.active())
+    {
+      span.annotate("filter", "prepositions in groups "
+        + verbly::implode(std::begin(groups), std::end(groups), ", "));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    verbly::filter pgf(true);
+    for (const std::string& choice : groups)
+    {
+      pgf += (verbly::notion::prepositionGroups == choice);
+    }
+
+    cached = prepositions_.emplace(
+      groups,
+      database_.words(
+        pgf && (verbly::notion::partOfSpeech == verbly::part_of_speech::preposition),
+        {},
+        -1).all()).first;
+
+    stats_.missTime += std::chrono::steady_clock::now() - start;
+  }
+
+  if (cached->second.empty())
+  {
+    throw std::out_of_range("No prepositions in groups");
+  }
+
+  return cached->second;
+}
@@ -0,0 +1,82 @@
+#ifndef QUERY_MEMO_H_E7C25A19
+#define QUERY_MEMO_H_E7C25A19
+
+#include <verbly.h>
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * How well a query_memo has been doing.
+ */
+struct query_stats {
+  unsigned long hits = 0;
+  unsigned long misses = 0;
+  unsigned long titles = 0;
+
+  // Time spent running the queries that missed.
+  std::chrono::duration<double> missTime = std::chrono::duration<double>::zero();
+
+  double hitRate() const;
+
+  /**
+   * Estimates the time saved per title, assuming each hit would have taken
+   * as long as the average miss.
+   */
+  std::chrono::duration<double> savedPerTitle() const;
+
+  query_stats& operator+=(const query_stats& other);
+};
+
+std::ostream& operator<<(std::ostream& out, const query_stats& stats);
+
+/**
+ * Remembers the full results of the queries that the generator makes over
+ * and over with the same parameters: the frames of a verb, and the
+ * prepositions in a set of groups. Callers choose randomly among the
+ * results, just as the queries themselves would have.
+ *
+ * A memo belongs to one generator and is not thread-safe.
+ */
+class query_memo {
+public:
+
+  explicit query_memo(const verbly::database& database);
+
+  /**
+   * Throws std::out_of_range if the verb has no frames.
+   */
+  const std::vector<verbly::frame>& frames(
+    const verbly::word& verb,
+    bool experiencer);
+
+  /**
+   * Throws std::out_of_range if no prepositions are in the groups.
+   */
+  const std::vector<verbly::word>& prepositions(
+    const std::vector<std::string>& groups);
+
+  const query_stats& getStats() const
+  {
+    return stats_;
+  }
+
+  void countTitle()
+  {
+    stats_.titles++;
+  }
+
+private:
+
+  const verbly::database& database_;
+
+  std::map<std::pair<int, bool>, std::vector<verbly::frame>> frames_;
+  std::map<std::vector<std::string>, std::vector<verbly::word>> prepositions_;
+
+  query_stats stats_;
+};
+
+#endif /* end of include guard: QUERY_MEMO_H_E7C25A19 */
@@ -0,0 +1,204 @@
+#include "renderer.h"
+#include <verbly.h>
+#include <list>
+
+namespace {
+
+  const double titlePointSize = 20;
+  const double maxLineWidth = 380;
+
+  // Bounds the metrics cache, which otherwise grows with every whole line
+  // that is measured.
+  const size_t maxCachedMetrics = 65536;
+
+}
+
+const int renderer::width;
+const int renderer::height;
+
+renderer::renderer(std::string fontfile) :
+  fontfile_(std::move(fontfile)),
+  measuringImage_(Magick::Geometry(1, 1), Magick::Color("white"))
+{
+  measuringImage_.font(fontfile_);
+
+  // The text's style is the same on every overlay, so its drawables are
+  // built once here and copied into each draw list.
+  textStyle_.push_back(Magick::DrawableFont(fontfile_));
+  textStyle_.push_back(Magick::DrawableFillColor("white"));
+
+  std::lock_guard<std::mutex> metricsLock(metricsMutex_);
+
+  // The height of the text does not depend on what it says.
+  lineHeight_ = measure(titlePointSize, "How to").height - 2;
+
+  // Measuring a space in context includes whatever extra width the font
+  // puts around each measured string, which then cancels out when words are
+  // added up.
+  spaceWidth_ = measure(titlePointSize, "x x").width
+    - 2 * measure(titlePointSize, "x").width;
+}
+
+void renderer::cropAndZoom(Magick::Image& pic) const
+{
+  // Want a 16:9 aspect
+  int idealwidth = pic.rows()*(16.0/9.0);
+  if (idealwidth > pic.columns())
+  {
+    // If the image is narrower than the ideal width, use full width.
+    int newheight = pic.columns()*(9.0/16.0);
+
+    // Just take a slice out of the middle of the image.
+    int cropy = ((double)(pic.rows() - newheight))/2.0;
+
+    pic.crop(Magick::Geometry(pic.columns(), newheight, 0, cropy));
+  } else if (idealwidth < pic.columns())
+  {
+    // If the image is wider than the ideal width, use full height.
+    // Just take a slice out of the middle of the image.
+    int cropx = ((double)(pic.columns() - idealwidth))/2.0;
+
+    pic.crop(Magick::Geometry(idealwidth, pic.rows(), cropx, 0));
+  }
+
+  // Images decoded with a size hint can already be the right size, in which
+  // case zooming would only copy them.
+  if ((pic.columns() != width) || (pic.rows() != height))
+  {
+    pic.zoom(Magick::Geometry(width, height));
+  }
+}
+
+text_layout renderer::layoutText(const std::string& title) const
+{
+  text_layout layout;
+  layout.lineHeight = lineHeight_;
+
+  std::vector<std::string> words = verbly::split<std::vector<std::string>>(title, " ");
+
+  std::lock_guard<std::mutex> metricsLock(metricsMutex_);
+
+  // Words are added while the sum of their widths fits, which is cheap but
+  // can be off by a few pixels due to kerning and rounding. So the sum is
+  // only a guess: the line with the next word is measured as a whole before
+  // giving up on it, and the line itself is measured before it is committed,
+  // dropping words until it really fits. A line never gets narrower when a
+  // word is added to it, so this breaks exactly where measuring every prefix
+  // would.
+  size_t lineStart = 0;
+  double lineWidth = 0;
+  size_t i = 0;
+
+  while (lineStart < words.size())
+  {
+    if (i < words.size())
+    {
+      double wordWidth = measure(titlePointSize, words[i]).width;
+      double nextWidth = (i == lineStart)
+        ? wordWidth
+        : lineWidth + spaceWidth_ + wordWidth;
+
+      if ((nextWidth > maxLineWidth) && (i > lineStart))
+      {
+        nextWidth = measureLine(words, lineStart, i + 1);
+      }
+
+      if (nextWidth <= maxLineWidth)
+      {
+        lineWidth = nextWidth;
+        i++;
+
+        continue;
+      }
+    }
+
+    // A line of one word was already measured exactly when it was added.
+    while ((i - lineStart > 1) && (measureLine(words, lineStart, i) > maxLineWidth))
+    {
+      i--;
+    }
+
+    if (i == lineStart)
+    {
+      // The word is too wide for any line, so it gets one of its own.
+      i++;
+    }
+
+    layout.lines.push_back(verbly::implode(
+      std::begin(words) + lineStart,
+      std::begin(words) + i,
+      " "));
+
+    lineStart = i;
+    lineWidth = 0;
+  }
+
+  return layout;
+}
+
+void renderer::drawOverlay(
+  Magick::Image& pic,
+  const text_layout& layout) const
+{
+  int blockHeight = layout.blockHeight();
+
+  // Everything is drawn in one pass. The box's translucency and stroke are
+  // kept to their own graphic context so that the text is drawn opaque.
+  std::list<Magick::Drawable> drawList;
+  drawList.push_back(Magick::DrawablePushGraphicContext());
+  drawList.push_back(Magick::DrawableFillColor("black"));
+  drawList.push_back(Magick::DrawableFillOpacity(0.5));
+  drawList.push_back(Magick::DrawableStrokeColor("transparent"));
+  drawList.push_back(Magick::DrawableRectangle(0, 225-blockHeight-20, 400, 255)); // 0, 225-60, 400, 255
+  drawList.push_back(Magick::DrawablePopGraphicContext());
+
+  drawList.insert(std::end(drawList), std::begin(textStyle_), std::end(textStyle_));
+  drawList.push_back(Magick::DrawablePointSize(14));
+  drawList.push_back(Magick::DrawableText(10, 225-blockHeight+4, "How to")); // 10, 255-62-4
+
+  drawList.push_back(Magick::DrawablePointSize(titlePointSize));
+  for (int i=0; i<layout.lines.size(); i++)
+  {
+    drawList.push_back(Magick::DrawableText(10, 255-blockHeight+(i*layout.lineHeight)-4, layout.lines[i])); // 10, 255-20-25
+  }
+
+  pic.draw(drawList);
+}
+
+double renderer::measureLine(
+  const std::vector<std::string>& words,
+  size_t first,
+  size_t last) const
+{
+  return measure(
+    titlePointSize,
+    verbly::implode(std::begin(words) + first, std::begin(words) + last, " ")).width;
+}
+
+const renderer::glyph_metrics& renderer::measure(
+  double pointSize,
+  const std::string& text) const
+{
+  std::pair<double, std::string> key(pointSize, text);
+
+  auto cached = metrics_.find(key);
+  if (cached != std::end(metrics_))
+  {
+    return cached->second;
+  }
+
+  if (metrics_.size() >= maxCachedMetrics)
+  {
+    metrics_.clear();
+  }
+
+  Magick::TypeMetric metric;
+  measuringImage_.fontPointsize(pointSize);
+  measuringImage_.fontTypeMetrics(text, &metric);
+
+  glyph_metrics result;
+  result.width = metric.textWidth();
+  result.height = metric.textHeight();
+
+  return metrics_.emplace(std::move(key), result).first->second;
+}
@@ -0,0 +1,105 @@
+#ifndef RENDERER_H_B7215E0C
+#define RENDERER_H_B7215E0C
+
+#include <Magick++.h>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The title wrapped into lines that fit on the output image.
+ */
+struct text_layout {
+  std::vector<std::string> lines;
+  int lineHeight = 0;
+
+  int blockHeight() const
+  {
+    return lineHeight * lines.size() + 18;
+  }
+};
+
+/**
+ * Turns a picture and a title into the image that gets posted.
+ */
+class renderer {
+public:
+
+  static const int width = 400;
+  static const int height = 225;
+
+  /**
+   * Loads the font up front, so that a missing or broken font file is
+   * reported at startup rather than when the first picture is rendered.
+   */
+  explicit renderer(std::string fontfile);
+
+  /**
+   * Crops the middle of the picture to a 16:9 aspect ratio and zooms it to
+   * the output size.
+   */
+  void cropAndZoom(Magick::Image& pic) const;
+
+  /**
+   * Greedily wraps the title into lines that fit across the picture. Words
+   * are measured once and their widths are added up, and each line is
+   * measured as a whole before it is committed, so the breaks are the same
+   * as measuring every prefix. layout_test checks this against the old
+   * loop.
+   */
+  text_layout layoutText(const std::string& title) const;
+
+  /**
+   * The distance between the baselines of the title's lines.
+   */
+  int lineHeight() const
+  {
+    return lineHeight_;
+  }
+
+  /**
+   * Draws the translucent box and the wrapped title over the bottom of the
+   * picture, in a single draw call.
+   */
+  void drawOverlay(
+    Magick::Image& pic,
+    const text_layout& layout) const;
+
+private:
+
+  struct glyph_metrics {
+    double width;
+    double height;
+  };
+
+  /**
+   * Measures text in the renderer's font, remembering the result. The cache
+   * mutex must be held.
+   */
+  const glyph_metrics& measure(double pointSize, const std::string& text) const;
+
+  /**
+   * Measures words first up to last joined into a line of the title. The
+   * cache mutex must be held.
+   */
+  double measureLine(
+    const std::vector<std::string>& words,
+    size_t first,
+    size_t last) const;
+
+  std::string fontfile_;
+  std::list<Magick::Drawable> textStyle_;
+  int lineHeight_;
+  double spaceWidth_;
+
+  // Every entry is in fontfile_, so the cache is keyed by point size and
+  // text.
+  mutable std::mutex metricsMutex_;
+  mutable Magick::Image measuringImage_;
+  mutable std::map<std::pair<double, std::string>, glyph_metrics> metrics_;
+};
+
+#endif /* end of include guard: RENDERER_H_B7215E0C */
@@ -0,0 +1,95 @@
+#include "scheduler.h"
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include "logger.h"
+
+scheduler::scheduler(scheduler_config config, std::mt19937::result_type seed) :
+  config_(std::move(config)),
+  rng_(seed)
+{
+  if (config_.interval <= std::chrono::seconds::zero())
+  {
+    config_.interval = std::chrono::hours(1);
+  }
+
+  // A negative wait would leave the jitter with an empty range.
+  config_.baseBackoff = std::max(config_.baseBackoff, std::chrono::seconds::zero());
+  config_.maxBackoff = std::max(config_.maxBackoff, config_.baseBackoff);
+
+  slot_ = slotAfter(clock::now());
+
+  std::time_t first = clock::to_time_t(slot_);
+  LOG(info) << "First post due at " << std::put_time(std::localtime(&first), "%c");
+}
+
+scheduler::clock::time_point scheduler::nextSlot() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return slot_;
+}
+
+void scheduler::posted()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  clock::time_point now = clock::now();
+  std::chrono::duration<double> lateness = now - slot_;
+
+  LOG(info) << "Posted " << lateness.count() << "s after its slot";
+
+  clock::time_point next = slotAfter(now);
+  int skipped = (next - slot_) / config_.interval - 1;
+  if (skipped > 0)
+  {
+    LOG(info) << "Skipped " << skipped << " slots";
+  }
+
+  slot_ = next;
+  failures_.clear();
+}
+
+std::chrono::seconds scheduler::failed(failure_class reason)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  int attempt = ++failures_[reason];
+
+  // Double the wait each time, stopping once it reaches the maximum.
+  std::chrono::seconds backoff = config_.baseBackoff;
+  for (int i = 1; (i < attempt) && (backoff < config_.maxBackoff); i++)
+  {
+    backoff *= 2;
+  }
+
+  backoff = std::min(backoff, config_.maxBackoff);
+
+  // Wait somewhere between half and all of it, so that retries do not line
+  // up with whatever else is hitting the same service.
+  std::uniform_int_distribution<std::chrono::seconds::rep> jitter(
+    backoff.count() / 2,
+    backoff.count());
+  std::chrono::seconds wait(jitter(rng_));
+
+  LOG(info) << "Retrying in " << wait.count() << " seconds...";
+
+  return wait;
+}
+
+void scheduler::succeeded(failure_class reason)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  failures_.erase(reason);
+}
+
+scheduler::clock::time_point scheduler::slotAfter(clock::time_point time) const
+{
+  std::chrono::seconds sinceEpoch =
+    std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch());
+
+  std::chrono::seconds::rep slots = sinceEpoch / config_.interval + 1;
+
+  return clock::time_point(config_.interval * slots);
+}
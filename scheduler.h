@@ -0,0 +1,75 @@
+#ifndef SCHEDULER_H_62E0B9A7
+#define SCHEDULER_H_62E0B9A7
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+
+enum class failure_class {
+  image,
+  fetch,
+  twitter
+};
+
+/**
+ * Settings for when posts go out, read from the config file.
+ */
+struct scheduler_config {
+  // Posts are due at whole multiples of the interval since the epoch, so an
+  // hourly bot posts on the hour.
+  std::chrono::seconds interval = std::chrono::hours(1);
+
+  // Retries after a failure wait twice as long each time, with jitter, up
+  // to the maximum.
+  std::chrono::seconds baseBackoff = std::chrono::seconds(30);
+  std::chrono::seconds maxBackoff = std::chrono::minutes(30);
+};
+
+/**
+ * Decides when the bot publishes each post. Posts target fixed slots on the
+ * wall clock, so time spent preparing them does not push the schedule back.
+ * The render and posting threads share the scheduler.
+ */
+class scheduler {
+public:
+
+  using clock = std::chrono::system_clock;
+
+  scheduler(scheduler_config config, std::mt19937::result_type seed);
+
+  /**
+   * The time the next post is due.
+   */
+  clock::time_point nextSlot() const;
+
+  /**
+   * Reports how late the post was, and moves on to the next slot that has
+   * not yet begun.
+   */
+  void posted();
+
+  /**
+   * Returns how long to wait before retrying after a failure, which is
+   * longer each time in a row that the same kind of failure happens.
+   */
+  std::chrono::seconds failed(failure_class reason);
+
+  /**
+   * Forgets the failures in a row of one kind, after it has worked again.
+   */
+  void succeeded(failure_class reason);
+
+private:
+
+  clock::time_point slotAfter(clock::time_point time) const;
+
+  scheduler_config config_;
+
+  mutable std::mutex mutex_;
+  std::mt19937 rng_;
+  clock::time_point slot_;
+  std::map<failure_class, int> failures_;
+};
+
+#endif /* end of include guard: SCHEDULER_H_62E0B9A7 */
@@ -0,0 +1,133 @@
+#include "selrestrs.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+  // Both tables must be kept sorted by name so that they can be binary
+  // searched; this is checked at compile time below.
+  constexpr selrestr_mapping selrestrTable[] = {
+    {"abstract", {100002137, 0}}, // abstract entity
+    {"animal", {100015388, 0}}, // animal
+    {"animate", {100004258, 0}}, // animate thing
+    {"artifact", {100021939, 0}}, // artifact
+    {"body_part", {105220461, 0}}, // body part
+    {"comestible", {100021265, 0}}, // food
+    {"communication", {100033020, 0}}, // communication
+    {"concrete", {100001930, 0}}, // physical entity
+    {"concrete_inanimate", {100021939, 100019128}}, // artifact, natural object
+    {"currency", {105050379, 0}}, // currency
+    {"garment", {103051540, 0}}, // clothing
+    {"human", {100007846, 0}}, // person
+    {"idea", {105803379, 0}}, // idea
+    {"inanimate", {100021939, 100019128}}, // artifact, natural object
+    {"int_control", {100007347, 0}}, // causal agent
+    {"location", {100027167, 0}}, // location
+    {"machine", {102958343, 0}}, // machine
+    {"natural", {100019128, 0}}, // natural object
+    {"non_region_location", {102913152, 0}}, // building
+    {"non_solid_food", {107881800, 0}}, // beverage
+    {"organization", {100237078, 0}}, // organization
+    {"phys_obj", {100002684, 0}}, // physical object
+    {"place", {100586262, 0}}, // place
+    {"plant", {103956922, 0}}, // plant
+    {"region", {105221895, 0}}, // region
+    {"scalar", {103835412, 0}}, // number
+    {"shape", {100027807, 0}}, // shape
+    {"slinky", {103670849, 0}}, // line
+    {"solid", {113860793, 0}}, // solid
+    {"solid_food", {107555863, 0}}, // solid food
+    {"sound", {107111047, 0}}, // sound
+    {"state", {100024720, 0}}, // state
+    {"substance", {100019613, 0}}, // substance
+    {"time", {100028270, 0}}, // time
+    {"tool", {104451818, 0}}, // tool
+    {"vehicle", {104524313, 0}} // vehicle
+  };
+
+  constexpr selrestr_mapping roleTable[] = {
+    {"Agent", {100007347, 0}}, // causal agent
+    {"Attribute", {100024264, 0}}, // attribute
+    {"Instrument", {104451818, 0}} // tool
+  };
+
+  constexpr int compareNames(const char* left, const char* right)
+  {
+    return ((*left != *right) || (*left == '\0'))
+      ? (*left - *right)
+      : compareNames(left + 1, right + 1);
+  }
+
+  template <size_t N>
+  constexpr bool isSorted(const selrestr_mapping (&table)[N], size_t i = 0)
+  {
+    return (i + 1 >= N)
+      || ((compareNames(table[i].name, table[i+1].name) < 0)
+        && isSorted(table, i + 1));
+  }
+
+  static_assert(isSorted(selrestrTable), "selrestrTable must be sorted by name");
+  static_assert(isSorted(roleTable), "roleTable must be sorted by name");
+
+  template <size_t N>
+  const selrestr_mapping* find(
+    const selrestr_mapping (&table)[N],
+    const std::string& name)
+  {
+    const selrestr_mapping* result = std::lower_bound(
+      std::begin(table),
+      std::end(table),
+      name.c_str(),
+      [] (const selrestr_mapping& mapping, const char* value) {
+        return std::strcmp(mapping.name, value) < 0;
+      });
+
+    if ((result != std::end(table)) && (name == result->name))
+    {
+      return result;
+    } else {
+      return nullptr;
+    }
+  }
+
+}
+
+const selrestr_mapping* findSelrestr(const std::string& name)
+{
+  return find(selrestrTable, name);
+}
+
+const selrestr_mapping* findRole(const std::string& name)
+{
+  return find(roleTable, name);
+}
+
+std::set<int> mappedWnids()
+{
+  std::set<int> result;
+
+  for (const selrestr_mapping& mapping : selrestrTable)
+  {
+    for (int wnid : mapping.wnids)
+    {
+      if (wnid != 0)
+      {
+        result.insert(wnid);
+      }
+    }
+  }
+
+  for (const selrestr_mapping& mapping : roleTable)
+  {
+    for (int wnid : mapping.wnids)
+    {
+      if (wnid != 0)
+      {
+        result.insert(wnid);
+      }
+    }
+  }
+
+  return result;
+}
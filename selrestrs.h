@@ -0,0 +1,33 @@
+#ifndef SELRESTRS_H_C81F02D4
+#define SELRESTRS_H_C81F02D4
+
+#include <string>
+#include <set>
+
+/**
+ * The notions whose hyponyms satisfy a selection restriction or role. Unused
+ * slots in wnids are zero.
+ */
+struct selrestr_mapping {
+  const char* name;
+  int wnids[2];
+};
+
+/**
+ * Looks up a selection restriction by name, returning nullptr if it is not
+ * one that the generator knows about.
+ */
+const selrestr_mapping* findSelrestr(const std::string& name);
+
+/**
+ * Looks up the fallback notion for a role, returning nullptr if the role has
+ * none.
+ */
+const selrestr_mapping* findRole(const std::string& name);
+
+/**
+ * Returns every notion mentioned by either table.
+ */
+std::set<int> mappedWnids();
+
+#endif /* end of include guard: SELRESTRS_H_C81F02D4 */
@@ -1,4 +1,6 @@
 #include "sentence.h"
+#include "trace.h"
+#include "logger.h"
 #include <algorithm>
 #include <list>
 #include <set>
@@ -7,25 +9,28 @@ sentence::sentence(
   const verbly::database& database,
   std::mt19937& rng) :
     database_(database),
-    rng_(rng)
+    rng_(rng),
+    memo_(database)
 {
-  verbly::filter blacklist;
-
-  for (std::string word : {
-    "raped", "Negro"
-  })
-  {
-    blacklist |= (verbly::form::text == word);
-  }
-
-  badWords_ = !blacklist;
+  // Load the words to choose from.
+  vocabulary_ = std::make_shared<vocabulary>(database_);
+}
 
-   // Blacklist ethnic slurs
-  badWords_ &= !(verbly::word::usageDomains %= (verbly::notion::wnid == 106718862));
+sentence::sentence(
+  const verbly::database& database,
+  std::mt19937& rng,
+  std::shared_ptr<const vocabulary> vocab) :
+    database_(database),
+    rng_(rng),
+    vocabulary_(std::move(vocab)),
+    memo_(database)
+{
 }
 
 std::string sentence::generate() const
 {
+  trace_span span("generate", "sentence");
+
   // Generate the form that the title should take.
   verbly::token form;
   std::set<std::string> synrestrs {"infinitive_phrase", "bare", "subjectless"};
@@ -68,12 +73,34 @@ std::string sentence::generate() const
   verbly::token tok = verbly::token::capitalize(
     verbly::token::casing::title_case, form);
 
-  while (!tok.isComplete())
+  // Expand the fillins in the order they appear. A fillin can expand into
+  // more fillins, which come before any that were already pending, so the
+  // pending fillins are kept on a stack with the first one on top.
+  std::vector<verbly::token*> pending;
+  std::vector<verbly::token*> found;
+
+  findFillins(tok, found);
+  pending.assign(found.rbegin(), found.rend());
+
+  while (!pending.empty())
   {
-    visit(tok);
+    verbly::token& fillin = *pending.back();
+    pending.pop_back();
+
+    visit(fillin);
+
+    found.clear();
+    findFillins(fillin, found);
+    pending.insert(std::end(pending), found.rbegin(), found.rend());
   }
 
   std::string compiled = tok.compile();
+  memo_.countTitle();
+
+  if (span.active())
+  {
+    span.annotate("title", compiled);
+  }
 
   return compiled;
 }
@@ -96,159 +123,7 @@ verbly::word sentence::generateStandardNoun(
   std::string role,
   std::set<std::string> selrestrs) const
 {
-  std::geometric_distribution<int> tagdist(0.5); // 0.06
-  std::vector<verbly::word> result;
-  bool trySelection = true;
-
-  while (result.empty())
-  {
-    verbly::filter condition =
-      (verbly::notion::partOfSpeech == verbly::part_of_speech::noun)
-      && (verbly::form::proper == false)
-      //&& (verbly::form::complexity == 1)
-     // && (verbly::word::tagCount >= tagdist(rng_)) // Favor more common words
-      && (verbly::word::tagCount >= 1)
-      && badWords_;
-
-    // Only use selection restrictions for a first attempt.
-    if (trySelection)
-    {
-      verbly::filter selection(true);
-
-      for (const std::string& selrestr : selrestrs)
-      {
-        if (selrestr == "concrete")
-        {
-          selection += (verbly::notion::wnid == 100001930); // physical entity
-        } else if (selrestr == "time")
-        {
-          selection += (verbly::notion::wnid == 100028270); // time
-        } else if (selrestr == "state")
-        {
-          selection += (verbly::notion::wnid == 100024720); // state
-        } else if (selrestr == "abstract")
-        {
-          selection += (verbly::notion::wnid == 100002137); // abstract entity
-        } else if (selrestr == "scalar")
-        {
-          selection += (verbly::notion::wnid == 103835412); // number
-        } else if (selrestr == "currency")
-        {
-          selection += (verbly::notion::wnid == 105050379); // currency
-        } else if (selrestr == "location")
-        {
-          selection += (verbly::notion::wnid == 100027167); // location
-        } else if (selrestr == "organization")
-        {
-          selection += (verbly::notion::wnid == 100237078); // organization
-        } else if (selrestr == "int_control")
-        {
-          selection += (verbly::notion::wnid == 100007347); // causal agent
-        } else if (selrestr == "natural")
-        {
-          selection += (verbly::notion::wnid == 100019128); // natural object
-        } else if (selrestr == "phys_obj")
-        {
-          selection += (verbly::notion::wnid == 100002684); // physical object
-        } else if (selrestr == "solid")
-        {
-          selection += (verbly::notion::wnid == 113860793); // solid
-        } else if (selrestr == "shape")
-        {
-          selection += (verbly::notion::wnid == 100027807); // shape
-        } else if (selrestr == "substance")
-        {
-          selection += (verbly::notion::wnid == 100019613); // substance
-        } else if (selrestr == "idea")
-        {
-          selection += (verbly::notion::wnid == 105803379); // idea
-        } else if (selrestr == "sound")
-        {
-          selection += (verbly::notion::wnid == 107111047); // sound
-        } else if (selrestr == "communication")
-        {
-          selection += (verbly::notion::wnid == 100033020); // communication
-        } else if (selrestr == "region")
-        {
-          selection += (verbly::notion::wnid == 105221895); // region
-        } else if (selrestr == "place")
-        {
-          selection += (verbly::notion::wnid == 100586262); // place
-        } else if (selrestr == "machine")
-        {
-          selection += (verbly::notion::wnid == 102958343); // machine
-        } else if (selrestr == "animate")
-        {
-          selection += (verbly::notion::wnid == 100004258); // animate thing
-        } else if (selrestr == "plant")
-        {
-          selection += (verbly::notion::wnid == 103956922); // plant
-        } else if (selrestr == "comestible")
-        {
-          selection += (verbly::notion::wnid == 100021265); // food
-        } else if (selrestr == "artifact")
-        {
-          selection += (verbly::notion::wnid == 100021939); // artifact
-        } else if (selrestr == "vehicle")
-        {
-          selection += (verbly::notion::wnid == 104524313); // vehicle
-        } else if (selrestr == "human")
-        {
-          selection += (verbly::notion::wnid == 100007846); // person
-        } else if (selrestr == "animal")
-        {
-          selection += (verbly::notion::wnid == 100015388); // animal
-        } else if (selrestr == "body_part")
-        {
-          selection += (verbly::notion::wnid == 105220461); // body part
-        } else if (selrestr == "garment")
-        {
-          selection += (verbly::notion::wnid == 103051540); // clothing
-        } else if (selrestr == "tool")
-        {
-          selection += (verbly::notion::wnid == 104451818); // tool
-        } else if ((selrestr == "concrete_inanimate") || (selrestr == "inanimate"))
-        {
-          selection += (verbly::notion::wnid == 100021939); // artifact
-          selection += (verbly::notion::wnid == 100019128); // natural object
-        } else if (selrestr == "non_region_location")
-        {
-          selection += (verbly::notion::wnid == 102913152); // building
-        } else if (selrestr == "non_solid_food")
-        {
-          selection += (verbly::notion::wnid == 107881800); // beverage
-        } else if (selrestr == "solid_food")
-        {
-          selection += (verbly::notion::wnid == 107555863); // solid food
-        } else if (selrestr == "slinky")
-        {
-          selection += (verbly::notion::wnid == 103670849); // line
-        }
-      }
-
-      if (selection.compact().getType() != verbly::filter::type::empty)
-      {
-        condition &= (verbly::notion::fullHypernyms %= std::move(selection));
-      } else if (role == "Attribute")
-      {
-        condition &= (verbly::notion::fullHypernyms %= (verbly::notion::wnid == 100024264)); // attribute
-      } else if (role == "Instrument")
-      {
-        condition &= (verbly::notion::fullHypernyms %= (verbly::notion::wnid == 104451818)); // tool
-      } else if (role == "Agent")
-      {
-        condition &= (verbly::notion::fullHypernyms %= (verbly::notion::wnid == 100007347)); // causal agent
-      }
-
-      trySelection = false;
-    } else {
-      std::cout << "Selection failed" << std::endl;
-    }
-
-    result = database_.words(condition).all();
-  }
-
-  return result.front();
+  return wordById(vocabulary_->getNouns().choose(role, selrestrs, rng_));
 }
 
 verbly::token sentence::generateStandardNounPhrase(
@@ -281,10 +156,7 @@ verbly::token sentence::generateStandardNounPhrase(
   {
     std::geometric_distribution<int> tagdist(0.2);
 
-    utter << database_.words(
-      (verbly::word::tagCount >= tagdist(rng_))
-      && (verbly::notion::partOfSpeech == verbly::part_of_speech::adjective)
-      && badWords_).first();
+    utter << chooseWord(vocabulary_->getAdjectives(), tagdist);
   }
 
   if (plural && noun.hasInflection(verbly::inflection::plural))
@@ -305,60 +177,40 @@ verbly::token sentence::generateStandardNounPhrase(
 verbly::token sentence::generateClause(
   const verbly::token& it) const
 {
+  trace_span span("generateClause", "sentence");
+
   verbly::token utter;
   std::geometric_distribution<int> tagdist(0.07);
-  std::vector<verbly::word> verbDataset;
-
-  verbly::filter frameCondition =
-    (verbly::frame::length >= 2)
-    && (verbly::frame::parts(0) %= (
-      (verbly::part::type == verbly::part_type::noun_phrase)
-      && (verbly::part::role == "Agent"))
-    && (verbly::frame::parts(1) %=
-      (verbly::part::type == verbly::part_type::verb))
-    && !(verbly::frame::parts() %= (
-      verbly::part::synrestrs %= "adjp")));
 
-  if (it.hasSynrestr("experiencer"))
-  {
-    frameCondition &=
-      (verbly::frame::parts(2) %=
-        (verbly::part::type == verbly::part_type::noun_phrase)
-        && !(verbly::part::synrestrs %= "genitive")
-        && ((verbly::part::role == "Patient")
-          || (verbly::part::role == "Experiencer")));
-  }
-
-  verbly::filter verbCondition =
-    (verbly::notion::partOfSpeech == verbly::part_of_speech::verb)
-    && frameCondition
-    && badWords_;
+  bool experiencer = it.hasSynrestr("experiencer");
+  verbly::inflection inflection = verbly::inflection::base;
 
   if (it.hasSynrestr("participle_phrase"))
   {
-    verbCondition &= (verbly::word::forms(verbly::inflection::ing_form));
+    inflection = verbly::inflection::ing_form;
   } else if (it.hasSynrestr("progressive"))
   {
-    verbCondition &= (verbly::word::forms(verbly::inflection::s_form));
+    inflection = verbly::inflection::s_form;
   } else if (it.hasSynrestr("past_participle"))
   {
-    verbCondition &= (verbly::word::forms(verbly::inflection::past_participle));
+    inflection = verbly::inflection::past_participle;
   }
 
-  // Because of the tag distribution, it's possible (albeit extremely unlikely)
-  // for the verb query to fail, so we loop until it succeeds.
-  while (verbDataset.empty())
-  {
-    verbDataset = database_.words(
-      verbCondition
-      && (verbly::word::tagCount >= tagdist(rng_))
-    ).all();
-  }
+  verbly::word verb = chooseWord(
+    vocabulary_->getVerbs(experiencer, inflection),
+    tagdist);
 
-  verbly::word verb = verbDataset.front();
-  verbly::frame frame = database_.frames(frameCondition && verb).first();
+  const std::vector<verbly::frame>& frames = memo_.frames(verb, experiencer);
+  const verbly::frame& frame =
+    frames[std::uniform_int_distribution<size_t>(0, frames.size()-1)(rng_)];
   std::list<verbly::part> parts(std::begin(frame.getParts()), std::end(frame.getParts()));
 
+  if (span.active())
+  {
+    span.annotate("verb", std::to_string(verb.getId()));
+    span.annotate("frame", std::to_string(frame.getId()));
+  }
+
   if (it.hasSynrestr("experiencer"))
   {
     // Ignore the direct object.
@@ -377,12 +229,10 @@ verbly::token sentence::generateClause(
     {
       case verbly::part_type::noun_phrase:
       {
-        std::cout << "NP: ";
-        for (auto& s : part.getNounSynrestrs())
-        {
-          std::cout << s << " ";
-        }
-        std::cout << std::endl;
+        LOG(debug) << "NP: " << verbly::implode(
+          std::begin(part.getNounSynrestrs()),
+          std::end(part.getNounSynrestrs()),
+          " ");
 
         if (chooseSelrestr(part.getNounSelrestrs(), {"currency"}))
         {
@@ -505,7 +355,7 @@ verbly::token sentence::generateClause(
 
       case verbly::part_type::verb:
       {
-        std::cout << "V: " << verb.getBaseForm().getText() << std::endl;
+        LOG(debug) << "V: " << verb.getBaseForm().getText();
 
         if (it.hasSynrestr("progressive"))
         {
@@ -533,20 +383,17 @@ verbly::token sentence::generateClause(
 
       case verbly::part_type::preposition:
       {
-        std::cout << "PREP" << std::endl;
+        LOG(debug) << "PREP";
 
         if (part.isPrepositionLiteral())
         {
           int choiceIndex = std::uniform_int_distribution<int>(0, part.getPrepositionChoices().size()-1)(rng_);
           utter << part.getPrepositionChoices()[choiceIndex];
         } else {
-          verbly::filter pgf(true);
-          for (const std::string& choice : part.getPrepositionChoices())
-          {
-            pgf += (verbly::notion::prepositionGroups == choice);
-          }
+          const std::vector<verbly::word>& prepositions =
+            memo_.prepositions(part.getPrepositionChoices());
 
-          utter << database_.words(pgf && (verbly::notion::partOfSpeech == verbly::part_of_speech::preposition)).first();
+          utter << prepositions[std::uniform_int_distribution<size_t>(0, prepositions.size()-1)(rng_)];
         }
 
         break;
@@ -554,7 +401,7 @@ verbly::token sentence::generateClause(
 
       case verbly::part_type::adjective:
       {
-        std::cout << "ADJ" << std::endl;
+        LOG(debug) << "ADJ";
 
         utter << std::set<std::string>({"adjective_phrase"});
 
@@ -563,7 +410,7 @@ verbly::token sentence::generateClause(
 
       case verbly::part_type::adverb:
       {
-        std::cout << "ADV" << std::endl;
+        LOG(debug) << "ADV";
 
         utter << std::set<std::string>({"adverb_phrase"});
 
@@ -572,7 +419,7 @@ verbly::token sentence::generateClause(
 
       case verbly::part_type::literal:
       {
-        std::cout << "LIT" << std::endl;
+        LOG(debug) << "LIT";
 
         utter << part.getLiteralValue();
 
@@ -598,83 +445,103 @@ verbly::token sentence::generateClause(
 
 void sentence::visit(verbly::token& it) const
 {
-  switch (it.getType())
+  trace_span span("visit", "sentence");
+
+  if (it.hasSynrestr("infinitive_phrase"))
   {
-    case verbly::token::type::utterance:
+    if (span.active())
     {
-      for (verbly::token& token : it)
-      {
-        if (!token.isComplete())
-        {
-          visit(token);
+      span.annotate("phrase", "infinitive_phrase");
+    }
 
-          break;
-        }
-      }
+    it = generateClause(it);
+  } else if (it.hasSynrestr("adjective_phrase"))
+  {
+    if (span.active())
+    {
+      span.annotate("phrase", "adjective_phrase");
+    }
 
-      break;
+    verbly::token phrase;
+
+    if (std::bernoulli_distribution(1.0/6.0)(rng_))
+    {
+      phrase << std::set<std::string>({"adverb_phrase"});
     }
 
-    case verbly::token::type::fillin:
+    if (std::bernoulli_distribution(1.0/4.0)(rng_))
     {
-      if (it.hasSynrestr("infinitive_phrase"))
-      {
-        it = generateClause(it);
-      } else if (it.hasSynrestr("adjective_phrase"))
-      {
-        verbly::token phrase;
+      phrase << std::set<std::string>({"participle_phrase", "subjectless"});
+    } else {
+      std::geometric_distribution<int> tagdist(0.2);
+      phrase << chooseWord(vocabulary_->getAdjectives(), tagdist);
+    }
 
-        if (std::bernoulli_distribution(1.0/6.0)(rng_))
-        {
-          phrase << std::set<std::string>({"adverb_phrase"});
-        }
+    it = phrase;
+  } else if (it.hasSynrestr("adverb_phrase"))
+  {
+    if (span.active())
+    {
+      span.annotate("phrase", "adverb_phrase");
+    }
 
-        if (std::bernoulli_distribution(1.0/4.0)(rng_))
-        {
-          phrase << std::set<std::string>({"participle_phrase", "subjectless"});
-        } else {
-          std::geometric_distribution<int> tagdist(0.2);
-          phrase << database_.words(
-            (verbly::word::tagCount >= tagdist(rng_))
-            && (verbly::notion::partOfSpeech == verbly::part_of_speech::adjective)
-            && badWords_).first();
-        }
+    std::geometric_distribution<int> tagdist(1.0/23.0);
 
-        it = phrase;
-      } else if (it.hasSynrestr("adverb_phrase"))
-      {
-        std::geometric_distribution<int> tagdist(1.0/23.0);
+    it = chooseWord(vocabulary_->getAdverbs(), tagdist);
+  } else if (it.hasSynrestr("participle_phrase"))
+  {
+    if (span.active())
+    {
+      span.annotate("phrase", "participle_phrase");
+    }
 
-        it = database_.words(
-          (verbly::notion::partOfSpeech == verbly::part_of_speech::adverb)
-          && (verbly::word::tagCount >= tagdist(rng_))
-          && badWords_).first();
-      } else if (it.hasSynrestr("participle_phrase"))
-      {
-        if (std::bernoulli_distribution(1.0/2.0)(rng_))
-        {
-          it = verbly::token(
-            database_.words(
-              (verbly::notion::partOfSpeech == verbly::part_of_speech::verb)
-              && (verbly::word::forms(verbly::inflection::ing_form))
-              && badWords_).first(),
-            verbly::inflection::ing_form);
-        } else {
-          it = generateClause(it);
-        }
-      } else if (it.hasSynrestr("past_participle"))
+    if (std::bernoulli_distribution(1.0/2.0)(rng_))
+    {
+      it = verbly::token(
+        wordById(vocabulary_->getIngVerbs().choose(rng_)),
+        verbly::inflection::ing_form);
+    } else {
+      it = generateClause(it);
+    }
+  } else if (it.hasSynrestr("past_participle"))
+  {
+    if (span.active())
+    {
+      span.annotate("phrase", "past_participle");
+    }
+
+    it = generateClause(it);
+  } else {
+    it = "*the reality of the situation*";
+  }
+}
+
+void sentence::findFillins(
+  verbly::token& it,
+  std::vector<verbly::token*>& fillins)
+{
+  switch (it.getType())
+  {
+    case verbly::token::type::utterance:
+    {
+      for (verbly::token& token : it)
       {
-        it = generateClause(it);
-      } else {
-        it = "*the reality of the situation*";
+        findFillins(token, fillins);
       }
 
       break;
     }
 
+    case verbly::token::type::fillin:
+    {
+      fillins.push_back(&it);
+
+      break;
+    }
+
     case verbly::token::type::transform:
     {
-      visit(it.getInnerToken());
+      findFillins(it.getInnerToken(), fillins);
 
       break;
     }
@@ -689,3 +556,30 @@ void sentence::visit(verbly::token& it) const
     }
   }
 }
+
+verbly::word sentence::chooseWord(
+  const word_pool& pool,
+  std::geometric_distribution<int>& tagdist) const
+{
+  // Because of the tag distribution, it's possible (albeit extremely unlikely)
+  // for no word to be common enough, so we loop until one is.
+  int wordId = -1;
+  while (wordId == -1)
+  {
+    wordId = pool.choose(tagdist(rng_), rng_);
+  }
+
+  return wordById(wordId);
+}
+
+verbly::word sentence::wordById(int wordId) const
+{
+  trace_span span("words", "verbly");
+
+  if (span.active())
+  {
+    span.annotate("filter", "word.id == " + std::to_string(wordId));
+  }
+
+  return database_.words(verbly::word::id == wordId).first();
+}
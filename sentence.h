@@ -4,6 +4,10 @@
 #include <verbly.h>
 #include <random>
 #include <string>
+#include <memory>
+#include <vector>
+#include "vocabulary.h"
+#include "query_memo.h"
 
 class sentence {
 public:
@@ -12,8 +16,30 @@ public:
     const verbly::database& database,
     std::mt19937& rng);
 
+  /**
+   * Creates a generator that shares an already loaded vocabulary. The
+   * vocabulary must have been loaded from the same datafile as database.
+   */
+  sentence(
+    const verbly::database& database,
+    std::mt19937& rng,
+    std::shared_ptr<const vocabulary> vocab);
+
+  std::shared_ptr<const vocabulary> getVocabulary() const
+  {
+    return vocabulary_;
+  }
+
   std::string generate() const;
 
+  /**
+   * How much the memoized frame and preposition queries have saved so far.
+   */
+  const query_stats& getQueryStats() const
+  {
+    return memo_.getStats();
+  }
+
 private:
 
   bool chooseSelrestr(std::set<std::string> selrestrs, std::set<std::string> choices) const;
@@ -30,10 +56,21 @@ private:
 
   void visit(verbly::token& it) const;
 
+  static void findFillins(
+    verbly::token& it,
+    std::vector<verbly::token*>& fillins);
+
+  verbly::word chooseWord(
+    const word_pool& pool,
+    std::geometric_distribution<int>& tagdist) const;
+
+  verbly::word wordById(int wordId) const;
+
   const verbly::database& database_;
   std::mt19937& rng_;
 
-  verbly::filter badWords_;
+  std::shared_ptr<const vocabulary> vocabulary_;
+  mutable query_memo memo_;
 };
 
 #endif /* end of include guard: SENTENCE_H_81987F60 */
@@ -0,0 +1,97 @@
+#include "renderer.h"
+#include "test/reference_layout.h"
+#include <Magick++.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+  // Titles picked to stress the line breaks: kerning pairs, runs of short
+  // words, and words too wide to fit on any line.
+  const std::vector<std::string> fixedTitles = {
+    "",
+    "Wax",
+    "AVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAV",
+    "Pneumonoultramicroscopicsilicovolcanoconiosis Pneumonoultramicroscopicsilicovolcanoconiosis",
+    "To Ty Yo Va Wa Av Aw LT LY To Ty Yo Va Wa Av Aw LT LY To Ty Yo Va Wa Av Aw LT LY",
+    "a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a a",
+    "Train Your Yak To Avoid The Waterfowl While Wearing A Very Wavy Toupee",
+    "Wrangle a tortoise with an unusually evocative typewriter in Wyoming",
+  };
+
+  const std::vector<std::string> vocabulary = {
+    "a", "an", "the", "To", "Yo", "Av", "Wave", "Tryst", "yawning",
+    "AVOWAL", "Lyttelton", "waterfowl", "typewriter", "Wyoming",
+    "unfathomably", "photosynthesize", "WWWWWWWWWWWW", "iiiiiiiiiiii",
+    "Transcontinental", "incomprehensibilities",
+  };
+
+  std::string randomTitle(std::mt19937& rng)
+  {
+    std::uniform_int_distribution<int> lengthDist(1, 30);
+    std::uniform_int_distribution<size_t> wordDist(0, vocabulary.size() - 1);
+
+    std::string title;
+    int length = lengthDist(rng);
+    for (int i = 0; i < length; i++)
+    {
+      if (i > 0)
+      {
+        title += " ";
+      }
+
+      title += vocabulary[wordDist(rng)];
+    }
+
+    return title;
+  }
+
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 2)
+  {
+    std::cout << "usage: layout_test [fontfile]" << std::endl;
+    return -1;
+  }
+
+  Magick::InitializeMagick(nullptr);
+
+  std::string fontfile = "@" + std::string(argv[1]);
+  renderer render(fontfile);
+
+  Magick::Image measuringImage(Magick::Geometry(1, 1), Magick::Color("white"));
+  measuringImage.font(fontfile);
+  measuringImage.fontPointsize(20);
+
+  std::vector<std::string> titles = fixedTitles;
+
+  // A fixed seed keeps failures reproducible.
+  std::mt19937 rng(0);
+  for (int i = 0; i < 500; i++)
+  {
+    titles.push_back(randomTitle(rng));
+  }
+
+  int mismatches = 0;
+  for (const std::string& title : titles)
+  {
+    if (render.layoutText(title).lines != referenceLayout(measuringImage, title))
+    {
+      std::cout << "layout differs from reference: " << title << std::endl;
+      mismatches++;
+    }
+  }
+
+  if (mismatches > 0)
+  {
+    std::cout << mismatches << " of " << titles.size()
+      << " titles were laid out differently from the reference" << std::endl;
+    return 1;
+  }
+
+  std::cout << titles.size() << " titles laid out as the reference does" << std::endl;
+}
@@ -0,0 +1,54 @@
+#ifndef REFERENCE_LAYOUT_H_3B8E51D4
+#define REFERENCE_LAYOUT_H_3B8E51D4
+
+#include <verbly.h>
+#include <Magick++.h>
+#include <list>
+#include <string>
+#include <vector>
+
+/**
+ * Wraps a title the way the renderer used to, by measuring every prefix of
+ * the line, so that the faster layout can be checked against it. The
+ * measuring image must already have the title's font and point size.
+ */
+inline std::vector<std::string> referenceLayout(
+  Magick::Image& measuringImage,
+  const std::string& title)
+{
+  std::vector<std::string> lines;
+  std::list<std::string> words = verbly::split<std::list<std::string>>(title, " ");
+  std::list<std::string> cur;
+  Magick::TypeMetric metric;
+
+  while (!words.empty())
+  {
+    cur.push_back(words.front());
+
+    std::string prefixText = verbly::implode(std::begin(cur), std::end(cur), " ");
+    measuringImage.fontTypeMetrics(prefixText, &metric);
+    if (metric.textWidth() > 380)
+    {
+      if (cur.size() == 1)
+      {
+        words.pop_front();
+      } else {
+        cur.pop_back();
+      }
+
+      lines.push_back(verbly::implode(std::begin(cur), std::end(cur), " "));
+      cur.clear();
+    } else {
+      words.pop_front();
+    }
+  }
+
+  if (!cur.empty())
+  {
+    lines.push_back(verbly::implode(std::begin(cur), std::end(cur), " "));
+  }
+
+  return lines;
+}
+
+#endif /* end of include guard: REFERENCE_LAYOUT_H_3B8E51D4 */
@@ -0,0 +1,195 @@
+#include "trace.h"
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+
+  std::mutex traceMutex;
+  std::ofstream traceFile;
+  tracer::clock::time_point traceStart;
+  bool firstEvent = true;
+
+  std::atomic<int> nextThreadId(1);
+
+  int currentThreadId()
+  {
+    static thread_local int id = nextThreadId++;
+
+    return id;
+  }
+
+  void writeString(std::ostream& out, const std::string& value)
+  {
+    out << '"';
+
+    for (char ch : value)
+    {
+      switch (ch)
+      {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+
+        default:
+        {
+          if (static_cast<unsigned char>(ch) < 0x20)
+          {
+            out << "\\u00" << "0123456789abcdef"[ch >> 4] << "0123456789abcdef"[ch & 0xF];
+          } else {
+            out << ch;
+          }
+        }
+      }
+    }
+
+    out << '"';
+  }
+
+  long long microseconds(tracer::clock::duration duration)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  }
+
+  void writeHeader(
+    std::ostream& out,
+    const char* name,
+    const char* category,
+    const char* phase,
+    tracer::clock::time_point at)
+  {
+    out << "{\"name\":";
+    writeString(out, name);
+    out << ",\"cat\":";
+    writeString(out, category);
+    out << ",\"ph\":\"" << phase << "\",\"ts\":" << microseconds(at - traceStart)
+      << ",\"pid\":" << getpid()
+      << ",\"tid\":" << currentThreadId();
+  }
+
+  void writeArguments(std::ostream& out, const tracer::arguments& args)
+  {
+    if (args.empty())
+    {
+      return;
+    }
+
+    out << ",\"args\":{";
+
+    for (auto it = std::begin(args); it != std::end(args); it++)
+    {
+      if (it != std::begin(args))
+      {
+        out << ",";
+      }
+
+      writeString(out, it->first);
+      out << ":";
+      writeString(out, it->second);
+    }
+
+    out << "}";
+  }
+
+  void write(const std::string& event)
+  {
+    std::lock_guard<std::mutex> traceLock(traceMutex);
+
+    // Tracing may have stopped while the event was being built.
+    if (!traceFile.is_open())
+    {
+      return;
+    }
+
+    traceFile << (firstEvent ? "\n" : ",\n") << event;
+    firstEvent = false;
+
+    // Flush each event so that the trace survives the bot being killed.
+    traceFile.flush();
+  }
+
+}
+
+std::atomic<bool> tracer::enabled_(false);
+
+void tracer::start(const std::string& path)
+{
+  std::lock_guard<std::mutex> traceLock(traceMutex);
+
+  traceFile.open(path, std::ios::trunc);
+  if (!traceFile)
+  {
+    throw std::runtime_error("Could not open trace file " + path);
+  }
+
+  traceFile << "[";
+  traceStart = clock::now();
+  firstEvent = true;
+
+  enabled_ = true;
+}
+
+void tracer::stop()
+{
+  std::lock_guard<std::mutex> traceLock(traceMutex);
+
+  if (!enabled_)
+  {
+    return;
+  }
+
+  enabled_ = false;
+
+  traceFile << "\n]\n";
+  traceFile.close();
+}
+
+void tracer::complete(
+  const char* name,
+  const char* category,
+  clock::time_point begin,
+  clock::time_point end,
+  const arguments& args)
+{
+  if (!enabled())
+  {
+    return;
+  }
+
+  // Build the event before taking the lock.
+  std::ostringstream event;
+  writeHeader(event, name, category, "X", begin);
+  event << ",\"dur\":" << microseconds(end - begin);
+  writeArguments(event, args);
+  event << "}";
+
+  write(event.str());
+}
+
+void tracer::asynchronous(
+  const char* name,
+  const char* category,
+  unsigned long id,
+  clock::time_point begin,
+  clock::time_point end,
+  const arguments& args)
+{
+  if (!enabled())
+  {
+    return;
+  }
+
+  std::ostringstream event;
+  writeHeader(event, name, category, "b", begin);
+  event << ",\"id\":" << id;
+  writeArguments(event, args);
+  event << "},\n";
+  writeHeader(event, name, category, "e", end);
+  event << ",\"id\":" << id << "}";
+
+  write(event.str());
+}
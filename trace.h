@@ -0,0 +1,121 @@
+#ifndef TRACE_H_0C7D4B92
+#define TRACE_H_0C7D4B92
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Writes a timeline of what the bot is doing as Chrome trace events, which
+ * can be opened in chrome://tracing or Perfetto. While tracing is off,
+ * recording an event costs one relaxed atomic load.
+ */
+class tracer {
+public:
+
+  using clock = std::chrono::steady_clock;
+  using arguments = std::vector<std::pair<std::string, std::string>>;
+
+  static bool enabled()
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Starts writing events to a file. Throws std::runtime_error if the file
+   * cannot be opened.
+   */
+  static void start(const std::string& path);
+
+  /**
+   * Finishes the file. The trace viewers also accept a file that was never
+   * finished, such as when the bot is killed.
+   */
+  static void stop();
+
+  /**
+   * Records something that happened between two times on the calling
+   * thread. Does nothing if tracing is off.
+   */
+  static void complete(
+    const char* name,
+    const char* category,
+    clock::time_point begin,
+    clock::time_point end,
+    const arguments& args = {});
+
+  /**
+   * Records something that happened between two times but that overlapped
+   * with other work on the same thread, such as one of several concurrent
+   * transfers. Events with the same id are drawn on the same track.
+   */
+  static void asynchronous(
+    const char* name,
+    const char* category,
+    unsigned long id,
+    clock::time_point begin,
+    clock::time_point end,
+    const arguments& args = {});
+
+private:
+
+  static std::atomic<bool> enabled_;
+};
+
+/**
+ * Records the lifetime of a scope as a trace event.
+ */
+class trace_span {
+public:
+
+  trace_span(const char* name, const char* category) :
+    name_(name),
+    category_(category),
+    active_(tracer::enabled())
+  {
+    if (active_)
+    {
+      begin_ = tracer::clock::now();
+    }
+  }
+
+  ~trace_span()
+  {
+    if (active_)
+    {
+      tracer::complete(name_, category_, begin_, tracer::clock::now(), args_);
+    }
+  }
+
+  trace_span(const trace_span& other) = delete;
+  trace_span& operator=(const trace_span& other) = delete;
+
+  /**
+   * Whether the span is being recorded. Callers should check this before
+   * working out anything to annotate it with.
+   */
+  bool active() const
+  {
+    return active_;
+  }
+
+  void annotate(std::string key, std::string value)
+  {
+    if (active_)
+    {
+      args_.emplace_back(std::move(key), std::move(value));
+    }
+  }
+
+private:
+
+  const char* name_;
+  const char* category_;
+  bool active_;
+  tracer::clock::time_point begin_;
+  tracer::arguments args_;
+};
+
+#endif /* end of include guard: TRACE_H_0C7D4B92 */
@@ -0,0 +1,261 @@
+#include "url_list_cache.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+
+  const char listMagic[4] = {'A', 'D', 'V', 'U'};
+  const uint32_t listVersion = 1;
+
+}
+
+url_list url_list::parse(const std::string& data)
+{
+  url_list result;
+  result.blob_.reserve(data.length());
+  result.offsets_.push_back(0);
+
+  size_t start = 0;
+  while (start < data.length())
+  {
+    size_t end = data.find("\r\n", start);
+    if (end == std::string::npos)
+    {
+      end = data.length();
+    }
+
+    if (end > start)
+    {
+      result.blob_.append(data, start, end - start);
+      result.offsets_.push_back(result.blob_.length());
+    }
+
+    start = end + 2;
+  }
+
+  return result;
+}
+
+url_list_cache::url_list_cache(
+  fetcher& fetch,
+  std::string directory,
+  std::chrono::seconds ttl) :
+    fetcher_(fetch),
+    directory_(std::move(directory)),
+    ttl_(ttl)
+{
+  if ((mkdir(directory_.c_str(), 0755) != 0) && (errno != EEXIST))
+  {
+    throw std::runtime_error("Could not create URL list cache " + directory_);
+  }
+
+  thread_ = std::thread(&url_list_cache::refresh, this);
+}
+
+url_list_cache::~url_list_cache()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+
+  wake_.notify_all();
+
+  // This can wait for a refresh in progress to finish or time out.
+  thread_.join();
+}
+
+std::shared_ptr<const url_list> url_list_cache::get(int wnid, const std::string& url)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto found = entries_.find(wnid);
+  if (found == std::end(entries_))
+  {
+    entry loaded;
+    if (!load(wnid, loaded))
+    {
+      return nullptr;
+    }
+
+    found = entries_.emplace(wnid, std::move(loaded)).first;
+  }
+
+  if ((clock::now() - found->second.fetched > ttl_)
+    && refreshing_.insert(wnid).second)
+  {
+    pending_.emplace_back(wnid, url);
+    wake_.notify_one();
+  }
+
+  return found->second.list;
+}
+
+void url_list_cache::put(int wnid, std::shared_ptr<const url_list> list)
+{
+  entry stored;
+  stored.list = std::move(list);
+  stored.fetched = clock::now();
+
+  save(wnid, stored);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_[wnid] = std::move(stored);
+}
+
+std::string url_list_cache::path(int wnid) const
+{
+  return directory_ + "/" + std::to_string(wnid) + ".lst";
+}
+
+bool url_list_cache::load(int wnid, entry& result) const
+{
+  std::ifstream file(path(wnid), std::ios::binary | std::ios::ate);
+  if (!file)
+  {
+    return false;
+  }
+
+  // Nothing in the file is trusted, since it may have been truncated or
+  // corrupted; a list that fails any check is fetched again.
+  uint64_t fileSize = file.tellg();
+  file.seekg(0);
+
+  char magic[sizeof(listMagic)];
+  uint32_t version = 0;
+  int64_t fetched = 0;
+  uint32_t count = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  file.read(reinterpret_cast<char*>(&fetched), sizeof(fetched));
+  file.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+  if (!file
+    || !std::equal(std::begin(magic), std::end(magic), std::begin(listMagic))
+    || (version != listVersion))
+  {
+    return false;
+  }
+
+  uint64_t headerSize = sizeof(magic) + sizeof(version) + sizeof(fetched) + sizeof(count);
+  uint64_t offsetsSize = (static_cast<uint64_t>(count) + 1) * sizeof(uint32_t);
+  if (headerSize + offsetsSize > fileSize)
+  {
+    return false;
+  }
+
+  std::shared_ptr<url_list> list = std::make_shared<url_list>();
+  list->offsets_.resize(count + 1);
+  file.read(
+    reinterpret_cast<char*>(list->offsets_.data()),
+    list->offsets_.size() * sizeof(uint32_t));
+
+  if (!file
+    || (list->offsets_.front() != 0)
+    || !std::is_sorted(std::begin(list->offsets_), std::end(list->offsets_))
+    || (headerSize + offsetsSize + list->offsets_.back() != fileSize))
+  {
+    return false;
+  }
+
+  list->blob_.resize(list->offsets_.back());
+  file.read(&list->blob_[0], list->blob_.length());
+
+  if (!file)
+  {
+    return false;
+  }
+
+  result.list = std::move(list);
+  result.fetched = clock::time_point(std::chrono::seconds(fetched));
+
+  return true;
+}
+
+void url_list_cache::save(int wnid, const entry& stored) const
+{
+  const url_list& list = *stored.list;
+
+  int64_t fetched = std::chrono::duration_cast<std::chrono::seconds>(
+    stored.fetched.time_since_epoch()).count();
+  uint32_t count = list.size();
+
+  std::string finalPath = path(wnid);
+  std::string tempPath = finalPath + ".tmp";
+
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(listMagic, sizeof(listMagic));
+    file.write(reinterpret_cast<const char*>(&listVersion), sizeof(listVersion));
+    file.write(reinterpret_cast<const char*>(&fetched), sizeof(fetched));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    if (list.offsets_.empty())
+    {
+      uint32_t start = 0;
+      file.write(reinterpret_cast<const char*>(&start), sizeof(start));
+    } else {
+      file.write(
+        reinterpret_cast<const char*>(list.offsets_.data()),
+        list.offsets_.size() * sizeof(uint32_t));
+    }
+
+    file.write(list.blob_.data(), list.blob_.length());
+
+    if (!file)
+    {
+      std::remove(tempPath.c_str());
+
+      return;
+    }
+  }
+
+  std::rename(tempPath.c_str(), finalPath.c_str());
+}
+
+void url_list_cache::refresh()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;)
+  {
+    wake_.wait(lock, [this] () {
+      return stopping_ || !pending_.empty();
+    });
+
+    if (stopping_)
+    {
+      return;
+    }
+
+    std::pair<int, std::string> next = std::move(pending_.front());
+    pending_.pop_front();
+
+    lock.unlock();
+
+    // A failed refresh keeps the stale list, and is tried again the next
+    // time the notion comes up.
+    try
+    {
+      fetch_result lst = fetcher_.get(next.second);
+
+      if (lst.responseCode == 200)
+      {
+        put(next.first, std::make_shared<const url_list>(url_list::parse(lst.body)));
+
+        LOG(info) << "Refreshed URLs for " << next.first << ".";
+      }
+    } catch (const fetch_error& e)
+    {
+      LOG(warning) << next.second << ": " << e.what();
+    }
+
+    lock.lock();
+    refreshing_.erase(next.first);
+  }
+}
@@ -0,0 +1,120 @@
+#ifndef URL_LIST_CACHE_H_9E41B7D2
+#define URL_LIST_CACHE_H_9E41B7D2
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fetcher.h"
+
+/**
+ * The image URLs of a notion, stored back to back in one string with an
+ * array of offsets into it.
+ */
+class url_list {
+public:
+
+  /**
+   * Parses a list as downloaded from ImageNet, one URL per line. Blank lines
+   * are skipped.
+   */
+  static url_list parse(const std::string& data);
+
+  size_t size() const
+  {
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+  }
+
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  std::string operator[](size_t i) const
+  {
+    return blob_.substr(offsets_[i], length(i));
+  }
+
+  const char* data(size_t i) const
+  {
+    return blob_.data() + offsets_[i];
+  }
+
+  size_t length(size_t i) const
+  {
+    return offsets_[i+1] - offsets_[i];
+  }
+
+private:
+
+  friend class url_list_cache;
+
+  std::string blob_;
+  std::vector<uint32_t> offsets_;
+};
+
+/**
+ * Keeps the URL list of each notion on disk, one file per wnid, so that it
+ * only has to be downloaded again once it is older than the TTL. Stale lists
+ * are still returned, and are downloaded again on a background thread.
+ */
+class url_list_cache {
+public:
+
+  url_list_cache(fetcher& fetch, std::string directory, std::chrono::seconds ttl);
+
+  ~url_list_cache();
+
+  url_list_cache(const url_list_cache& other) = delete;
+  url_list_cache& operator=(const url_list_cache& other) = delete;
+
+  /**
+   * Returns the cached list for a notion, or nullptr if there is none. If
+   * the list is stale, it is refreshed from url in the background.
+   */
+  std::shared_ptr<const url_list> get(int wnid, const std::string& url);
+
+  /**
+   * Stores a freshly downloaded list.
+   */
+  void put(int wnid, std::shared_ptr<const url_list> list);
+
+private:
+
+  using clock = std::chrono::system_clock;
+
+  struct entry {
+    std::shared_ptr<const url_list> list;
+    clock::time_point fetched;
+  };
+
+  std::string path(int wnid) const;
+
+  bool load(int wnid, entry& result) const;
+
+  void save(int wnid, const entry& stored) const;
+
+  void refresh();
+
+  fetcher& fetcher_;
+  std::string directory_;
+  std::chrono::seconds ttl_;
+
+  std::mutex mutex_;
+  std::map<int, entry> entries_;
+  std::deque<std::pair<int, std::string>> pending_;
+  std::set<int> refreshing_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+
+  std::thread thread_;
+};
+
+#endif /* end of include guard: URL_LIST_CACHE_H_9E41B7D2 */
@@ -0,0 +1,99 @@
+#include "vocabulary.h"
+
+vocabulary::vocabulary(const verbly::database& database)
+{
+  verbly::filter blacklist;
+
+  for (std::string word : {
+    "raped", "Negro"
+  })
+  {
+    blacklist |= (verbly::form::text == word);
+  }
+
+  badWords_ = !blacklist;
+
+   // Blacklist ethnic slurs
+  badWords_ &= !(verbly::word::usageDomains %= (verbly::notion::wnid == 106718862));
+
+  // Index the nouns by selection restriction.
+  nouns_ = std::unique_ptr<noun_index>(new noun_index(database, badWords_));
+
+  // Load the words that the other single-word slots are chosen from.
+  adjectives_ = std::unique_ptr<word_pool>(new word_pool(database,
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::adjective)
+    && badWords_));
+
+  adverbs_ = std::unique_ptr<word_pool>(new word_pool(database,
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::adverb)
+    && badWords_));
+
+  ingVerbs_ = std::unique_ptr<word_pool>(new word_pool(database,
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::verb)
+    && (verbly::word::forms(verbly::inflection::ing_form))
+    && badWords_));
+
+  for (bool experiencer : {false, true})
+  {
+    for (verbly::inflection inflection : {
+      verbly::inflection::base,
+      verbly::inflection::ing_form,
+      verbly::inflection::s_form,
+      verbly::inflection::past_participle
+    })
+    {
+      verbs_[std::make_pair(experiencer, inflection)] =
+        std::unique_ptr<word_pool>(new word_pool(database,
+          verbCondition(experiencer, inflection)));
+    }
+  }
+}
+
+const word_pool& vocabulary::getVerbs(
+  bool experiencer,
+  verbly::inflection inflection) const
+{
+  return *verbs_.at(std::make_pair(experiencer, inflection));
+}
+
+verbly::filter vocabulary::frameCondition(bool experiencer)
+{
+  verbly::filter condition =
+    (verbly::frame::length >= 2)
+    && (verbly::frame::parts(0) %= (
+      (verbly::part::type == verbly::part_type::noun_phrase)
+      && (verbly::part::role == "Agent"))
+    && (verbly::frame::parts(1) %=
+      (verbly::part::type == verbly::part_type::verb))
+    && !(verbly::frame::parts() %= (
+      verbly::part::synrestrs %= "adjp")));
+
+  if (experiencer)
+  {
+    condition &=
+      (verbly::frame::parts(2) %=
+        (verbly::part::type == verbly::part_type::noun_phrase)
+        && !(verbly::part::synrestrs %= "genitive")
+        && ((verbly::part::role == "Patient")
+          || (verbly::part::role == "Experiencer")));
+  }
+
+  return condition;
+}
+
+verbly::filter vocabulary::verbCondition(
+  bool experiencer,
+  verbly::inflection inflection) const
+{
+  verbly::filter condition =
+    (verbly::notion::partOfSpeech == verbly::part_of_speech::verb)
+    && frameCondition(experiencer)
+    && badWords_;
+
+  if (inflection != verbly::inflection::base)
+  {
+    condition &= (verbly::word::forms(inflection));
+  }
+
+  return condition;
+}
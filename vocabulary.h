@@ -0,0 +1,66 @@
+#ifndef VOCABULARY_H_47B2E9D1
+#define VOCABULARY_H_47B2E9D1
+
+#include <verbly.h>
+#include <map>
+#include <memory>
+#include <utility>
+#include "noun_index.h"
+#include "word_pool.h"
+
+/**
+ * The words that sentence chooses from, loaded once from a database. It only
+ * stores word IDs and is not modified after construction, so one instance can
+ * be shared between generators running on different threads, each with its
+ * own database connection.
+ */
+class vocabulary {
+public:
+
+  explicit vocabulary(const verbly::database& database);
+
+  const noun_index& getNouns() const
+  {
+    return *nouns_;
+  }
+
+  const word_pool& getAdjectives() const
+  {
+    return *adjectives_;
+  }
+
+  const word_pool& getAdverbs() const
+  {
+    return *adverbs_;
+  }
+
+  const word_pool& getIngVerbs() const
+  {
+    return *ingVerbs_;
+  }
+
+  /**
+   * Returns the verbs that can head a clause, optionally restricted to
+   * frames with an experiencer and to verbs with the given inflection.
+   */
+  const word_pool& getVerbs(
+    bool experiencer,
+    verbly::inflection inflection) const;
+
+  static verbly::filter frameCondition(bool experiencer);
+
+private:
+
+  verbly::filter verbCondition(
+    bool experiencer,
+    verbly::inflection inflection) const;
+
+  verbly::filter badWords_;
+  std::unique_ptr<noun_index> nouns_;
+  std::unique_ptr<word_pool> adjectives_;
+  std::unique_ptr<word_pool> adverbs_;
+  std::unique_ptr<word_pool> ingVerbs_;
+  std::map<std::pair<bool, verbly::inflection>, std::unique_ptr<word_pool>> verbs_;
+};
+
+#endif /* end of include guard: VOCABULARY_H_47B2E9D1 */
@@ -0,0 +1,70 @@
+#include "word_pool.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+word_pool::word_pool(
+  const verbly::database& database,
+  verbly::filter condition)
+{
+  for (const verbly::word& word : database.words(std::move(condition), {}, -1).all())
+  {
+    words_.emplace_back(word.hasTagCount() ? word.getTagCount() : -1, word.getId());
+  }
+
+  sort();
+}
+
+word_pool::word_pool(std::vector<std::pair<int, int>> words) :
+  words_(std::move(words))
+{
+  sort();
+}
+
+void word_pool::sort()
+{
+  std::sort(
+    std::begin(words_),
+    std::end(words_),
+    [] (const std::pair<int, int>& left, const std::pair<int, int>& right) {
+      return (left.first > right.first)
+        || ((left.first == right.first) && (left.second < right.second));
+    });
+}
+
+int word_pool::choose(std::mt19937& rng) const
+{
+  if (words_.empty())
+  {
+    throw std::out_of_range("Word pool is empty");
+  }
+
+  std::uniform_int_distribution<size_t> dist(0, words_.size() - 1);
+
+  return words_[dist(rng)].second;
+}
+
+int word_pool::choose(int minTagCount, std::mt19937& rng) const
+{
+  if (words_.empty())
+  {
+    throw std::out_of_range("Word pool is empty");
+  }
+
+  auto last = std::partition_point(
+    std::begin(words_),
+    std::end(words_),
+    [=] (const std::pair<int, int>& word) {
+      return word.first >= minTagCount;
+    });
+
+  size_t count = std::distance(std::begin(words_), last);
+  if (count == 0)
+  {
+    return -1;
+  }
+
+  std::uniform_int_distribution<size_t> dist(0, count - 1);
+
+  return words_[dist(rng)].second;
+}
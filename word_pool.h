@@ -0,0 +1,60 @@
+#ifndef WORD_POOL_H_9D4E61A7
+#define WORD_POOL_H_9D4E61A7
+
+#include <verbly.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+/**
+ * The IDs of every word matching a filter, loaded once and sorted by
+ * descending tag count. This allows a uniformly random word with at least a
+ * given tag count to be sampled by counting the matching prefix and picking
+ * an offset into it, without querying the database each time.
+ */
+class word_pool {
+public:
+
+  word_pool(
+    const verbly::database& database,
+    verbly::filter condition);
+
+  /**
+   * Builds a pool from pairs of tag count and word ID, as returned by
+   * entries, for instance after reading them from a file.
+   */
+  explicit word_pool(std::vector<std::pair<int, int>> words);
+
+  size_t size() const
+  {
+    return words_.size();
+  }
+
+  const std::vector<std::pair<int, int>>& entries() const
+  {
+    return words_;
+  }
+
+  /**
+   * Chooses the ID of any word in the pool. Throws std::out_of_range if the
+   * pool is empty.
+   */
+  int choose(std::mt19937& rng) const;
+
+  /**
+   * Chooses the ID of a word with a tag count of at least minTagCount, or
+   * returns -1 if there are none. Throws std::out_of_range if the pool is
+   * empty.
+   */
+  int choose(int minTagCount, std::mt19937& rng) const;
+
+private:
+
+  void sort();
+
+  // Pairs of tag count and word ID. Words without a tag count are stored
+  // with a tag count of -1 so that they never satisfy a minimum.
+  std::vector<std::pair<int, int>> words_;
+};
+
+#endif /* end of include guard: WORD_POOL_H_9D4E61A7 */